@@ -0,0 +1,360 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 Nathan McCrina
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+/*
+ * magic bitboard technique is from the chess programming wiki (chessprogramming.wikispaces.com)
+ */
+
+#include "TuxedoCat.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define TUXEDOCAT_PEXT_AVAILABLE
+#define TUXEDOCAT_TARGET_BMI2
+#elif defined(__GNUC__) && defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define TUXEDOCAT_PEXT_AVAILABLE
+#define TUXEDOCAT_TARGET_BMI2 __attribute__((target("bmi2")))
+#endif
+
+using namespace TuxedoCat;
+
+struct MagicEntry
+{
+	uint64_t Mask;
+	uint64_t Magic;
+	uint64_t* Attacks;
+	int Shift;
+};
+
+static uint64_t RookAttackTable[102400];
+static uint64_t BishopAttackTable[5248];
+
+static MagicEntry RookMagics[64];
+static MagicEntry BishopMagics[64];
+
+static uint64_t LineTable[64][64];
+static uint64_t BetweenTable[64][64];
+
+static bool usePext = false;
+
+static const uint64_t RookMagicNumbers[64] = {
+	0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+	0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+	0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+	0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+	0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+	0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+	0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+	0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+	0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+	0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+	0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+	0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+	0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+	0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+	0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+	0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+static const uint64_t BishopMagicNumbers[64] = {
+	0xA010041108003100ULL, 0x006082020A002900ULL, 0x6810010619200000ULL, 0x08281A0520000408ULL,
+	0x0001104001000400ULL, 0x0018901008048400ULL, 0x00040A0210245280ULL, 0x000200210808A402ULL,
+	0x9140048410821200ULL, 0x0800091010820041ULL, 0x20504804832202C0ULL, 0x0100091401081000ULL,
+	0x8021011140000012ULL, 0x0810020804450400ULL, 0x208B0542109008A2ULL, 0x0080084A08040204ULL,
+	0x0040E2A80811244CULL, 0x2505022008008108ULL, 0x0430220100420040ULL, 0x010A040420220040ULL,
+	0x1105000290400000ULL, 0x0093001200822120ULL, 0x4000A62048043004ULL, 0x280120048A015004ULL,
+	0x006090002A020814ULL, 0x44042000240800D0ULL, 0x01102800040A4400ULL, 0x1004080080220040ULL,
+	0x0001001011004024ULL, 0x0010044000805040ULL, 0x0914041200820100ULL, 0x0004821012821480ULL,
+	0x0024040500C05021ULL, 0x0088611002080200ULL, 0x0116080A00040020ULL, 0x4000020080080080ULL,
+	0x2450450140840040ULL, 0x0000880201484100ULL, 0x0222020404020092ULL, 0x8081110600002E00ULL,
+	0x2842101105000801ULL, 0x1100809008001025ULL, 0x00020202221C0400ULL, 0x0422014022009020ULL,
+	0x0210046102100C00ULL, 0xC004008082029102ULL, 0x00AA461801101200ULL, 0x0404080080201108ULL,
+	0x020542108C205002ULL, 0x0410544804100100ULL, 0x0040910841100000ULL, 0x0400200042021100ULL,
+	0x00004204850400C0ULL, 0x0200100410A42102ULL, 0x1040020801210102ULL, 0x0805040410420000ULL,
+	0x2884804130100200ULL, 0x800C262201242000ULL, 0x1058000194108800ULL, 0x0014221054420204ULL,
+	0x0104000012A02200ULL, 0x0200881003300100ULL, 0x0140400202840100ULL, 0x0402020801010201ULL
+};
+
+static inline uint64_t GetMagicIndex(const MagicEntry& entry, uint64_t occupancy)
+{
+	return ((occupancy & entry.Mask) * entry.Magic) >> entry.Shift;
+}
+
+#ifdef TUXEDOCAT_PEXT_AVAILABLE
+
+TUXEDOCAT_TARGET_BMI2 static inline uint64_t GetPextIndex(const MagicEntry& entry, uint64_t occupancy)
+{
+	return _pext_u64(occupancy, entry.Mask);
+}
+
+// the whole lookup is compiled for bmi2 so the pext can be inlined into it; the callers
+// stay plain x86-64 and reach it through a direct call only when usePext is set
+TUXEDOCAT_TARGET_BMI2 static uint64_t GetPextAttacks(const MagicEntry& entry, uint64_t occupancy)
+{
+	return entry.Attacks[GetPextIndex(entry, occupancy)];
+}
+
+static void GetCpuid(int leaf, uint32_t registers[4])
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuidex(info, leaf, 0);
+
+	for (int i = 0; i < 4; i++)
+	{
+		registers[i] = static_cast<uint32_t>(info[i]);
+	}
+#else
+	__cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+static bool IsFastPextSupported()
+{
+	uint32_t registers[4];
+	uint32_t maxLeaf;
+	uint32_t family;
+	bool isAMD;
+
+	GetCpuid(0, registers);
+	maxLeaf = registers[0];
+	isAMD = registers[1] == 0x68747541 && registers[3] == 0x69746E65 && registers[2] == 0x444D4163;
+
+	if (maxLeaf < 7)
+	{
+		return false;
+	}
+
+	GetCpuid(1, registers);
+	family = ((registers[0] >> 8) & 0x0F) + ((registers[0] >> 20) & 0xFF);
+
+	// AMD parts before Zen 3 implement pext in microcode, the multiply is faster there
+
+	if (isAMD && family < 0x19)
+	{
+		return false;
+	}
+
+	GetCpuid(7, registers);
+
+	return (registers[1] & (1 << 8)) != 0;
+}
+
+#endif
+
+static uint64_t GetRayAttacks(int square, uint64_t occupancy, bool rook)
+{
+	uint64_t result = 0x0000000000000000ULL;
+	int blockerIndex;
+
+	if (rook)
+	{
+		blockerIndex = Utility::GetLSB(RayAttacksN[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksN[square] : RayAttacksN[square] & ~RayAttacksN[blockerIndex];
+
+		blockerIndex = Utility::GetLSB(RayAttacksE[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksE[square] : RayAttacksE[square] & ~RayAttacksE[blockerIndex];
+
+		blockerIndex = Utility::GetMSB(RayAttacksS[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksS[square] : RayAttacksS[square] & ~RayAttacksS[blockerIndex];
+
+		blockerIndex = Utility::GetMSB(RayAttacksW[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksW[square] : RayAttacksW[square] & ~RayAttacksW[blockerIndex];
+	}
+	else
+	{
+		blockerIndex = Utility::GetLSB(RayAttacksNE[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksNE[square] : RayAttacksNE[square] & ~RayAttacksNE[blockerIndex];
+
+		blockerIndex = Utility::GetLSB(RayAttacksNW[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksNW[square] : RayAttacksNW[square] & ~RayAttacksNW[blockerIndex];
+
+		blockerIndex = Utility::GetMSB(RayAttacksSE[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksSE[square] : RayAttacksSE[square] & ~RayAttacksSE[blockerIndex];
+
+		blockerIndex = Utility::GetMSB(RayAttacksSW[square] & occupancy);
+		result |= blockerIndex == -1 ? RayAttacksSW[square] : RayAttacksSW[square] & ~RayAttacksSW[blockerIndex];
+	}
+
+	return result;
+}
+
+static uint64_t GetOccupancyMask(int square, bool rook)
+{
+	const uint64_t rank1 = 0x00000000000000FFULL;
+	const uint64_t rank8 = 0xFF00000000000000ULL;
+	const uint64_t fileA = 0x0101010101010101ULL;
+	const uint64_t fileH = 0x8080808080808080ULL;
+
+	// the last square of each ray can never block anything, so leave it out of the mask
+
+	if (rook)
+	{
+		return (RayAttacksN[square] & ~rank8)
+			| (RayAttacksS[square] & ~rank1)
+			| (RayAttacksE[square] & ~fileH)
+			| (RayAttacksW[square] & ~fileA);
+	}
+	else
+	{
+		return (RayAttacksNE[square] | RayAttacksNW[square] | RayAttacksSE[square] | RayAttacksSW[square])
+			& ~(rank1 | rank8 | fileA | fileH);
+	}
+}
+
+// the tables are filled in the order the chosen lookup reads them
+static uint64_t GetIndex(const MagicEntry& entry, uint64_t occupancy)
+{
+#ifdef TUXEDOCAT_PEXT_AVAILABLE
+	if (usePext)
+	{
+		return GetPextIndex(entry, occupancy);
+	}
+#endif
+
+	return GetMagicIndex(entry, occupancy);
+}
+
+static void InitializeMagics(MagicEntry* magics, const uint64_t* magicNumbers, uint64_t* table, bool rook)
+{
+	uint64_t* nextAttacks = table;
+
+	for (int square = 0; square < 64; square++)
+	{
+		MagicEntry& entry = magics[square];
+		uint64_t occupancy = 0x0000000000000000ULL;
+
+		entry.Mask = GetOccupancyMask(square, rook);
+		entry.Magic = magicNumbers[square];
+		entry.Shift = 64 - Utility::PopCount(entry.Mask);
+		entry.Attacks = nextAttacks;
+
+		// walk every subset of the mask (carry-rippler) and store its attack set
+
+		do
+		{
+			entry.Attacks[GetIndex(entry, occupancy)] = GetRayAttacks(square, occupancy, rook);
+			occupancy = (occupancy - entry.Mask) & entry.Mask;
+		} while (occupancy != 0x0000000000000000ULL);
+
+		nextAttacks += (0x0000000000000001ULL << Utility::PopCount(entry.Mask));
+	}
+}
+
+static void InitializeLines()
+{
+	for (int from = 0; from < 64; from++)
+	{
+		uint64_t fromLocation = 0x0000000000000001ULL << from;
+
+		for (int to = 0; to < 64; to++)
+		{
+			uint64_t toLocation = 0x0000000000000001ULL << to;
+
+			LineTable[from][to] = 0x0000000000000000ULL;
+			BetweenTable[from][to] = 0x0000000000000000ULL;
+
+			if ((GetRayAttacks(from, 0x0000000000000000ULL, true) & toLocation) != 0x0000000000000000ULL)
+			{
+				LineTable[from][to] = (GetRayAttacks(from, 0x0000000000000000ULL, true)
+					& GetRayAttacks(to, 0x0000000000000000ULL, true)) | fromLocation | toLocation;
+				BetweenTable[from][to] = GetRayAttacks(from, toLocation, true) & GetRayAttacks(to, fromLocation, true);
+			}
+			else if ((GetRayAttacks(from, 0x0000000000000000ULL, false) & toLocation) != 0x0000000000000000ULL)
+			{
+				LineTable[from][to] = (GetRayAttacks(from, 0x0000000000000000ULL, false)
+					& GetRayAttacks(to, 0x0000000000000000ULL, false)) | fromLocation | toLocation;
+				BetweenTable[from][to] = GetRayAttacks(from, toLocation, false) & GetRayAttacks(to, fromLocation, false);
+			}
+		}
+	}
+}
+
+void Attacks::InitializeAttacks()
+{
+#ifdef TUXEDOCAT_PEXT_AVAILABLE
+	if (IsFastPextSupported())
+	{
+		usePext = true;
+	}
+#endif
+
+	InitializeMagics(RookMagics, RookMagicNumbers, RookAttackTable, true);
+	InitializeMagics(BishopMagics, BishopMagicNumbers, BishopAttackTable, false);
+	InitializeLines();
+
+	Logger::Write(LogLevel::Info, std::string("slider attack lookup: ") + GetBackendName());
+}
+
+std::string Attacks::GetBackendName()
+{
+	return usePext ? "pext" : "magic";
+}
+
+uint64_t Attacks::GetRookAttacks(int square, uint64_t occupancy)
+{
+	const MagicEntry& entry = RookMagics[square];
+
+#ifdef TUXEDOCAT_PEXT_AVAILABLE
+	if (usePext)
+	{
+		return GetPextAttacks(entry, occupancy);
+	}
+#endif
+
+	return entry.Attacks[GetMagicIndex(entry, occupancy)];
+}
+
+uint64_t Attacks::GetBishopAttacks(int square, uint64_t occupancy)
+{
+	const MagicEntry& entry = BishopMagics[square];
+
+#ifdef TUXEDOCAT_PEXT_AVAILABLE
+	if (usePext)
+	{
+		return GetPextAttacks(entry, occupancy);
+	}
+#endif
+
+	return entry.Attacks[GetMagicIndex(entry, occupancy)];
+}
+
+uint64_t Attacks::GetQueenAttacks(int square, uint64_t occupancy)
+{
+	return GetRookAttacks(square, occupancy) | GetBishopAttacks(square, occupancy);
+}
+
+uint64_t Attacks::GetLine(int from, int to)
+{
+	return LineTable[from][to];
+}
+
+uint64_t Attacks::GetBetween(int from, int to)
+{
+	return BetweenTable[from][to];
+}
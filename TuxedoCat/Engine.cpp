@@ -31,16 +31,47 @@
 #include <stack>
 #include <chrono>
 #include <algorithm>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <mutex>
+#include <condition_variable>
 
 using namespace TuxedoCat;
 
 Board currentPosition;
 TimeControl currentClock;
 
-static uint64_t nodeCount;
-static std::vector<std::vector<Move>> pvArrays;
-static int currentMaxDepth;
-static int currentBestScore;
+static std::vector<std::unique_ptr<SearchThread>> searchThreads;
+static std::atomic<bool> stopSearch(false);
+static std::atomic<bool> searchFinished(false);
+static std::atomic<bool> pondering(false);
+static std::mutex ponderMutex;
+static std::condition_variable ponderEnded;
+static std::thread searchWorker;
+static Move searchResult;
+static Move ponderMove;
+static void (*searchFinishedHandler)() = nullptr;
+static std::chrono::high_resolution_clock::time_point searchStart;
+static std::atomic<long long> searchDeadline;
+static std::atomic<uint64_t> ponderHitSearchTime;
+static bool searchDeadlineActive;
+
+static const int INFINITE_SCORE = 3000000;
+static const int MATE_SCORE = 2000000;
+static const int MATE_BOUND = MATE_SCORE - 1000;
+static const int DELTA_MARGIN = 200;
+static const int NULL_MOVE_MIN_DEPTH = 3;
+static const int NULL_MOVE_VERIFICATION_DEPTH = 10;
+static const int LATE_MOVE_PRUNING_DEPTH = 3;
+static const int ASPIRATION_MIN_DEPTH = 4;
+static const int ASPIRATION_WINDOW = 25;
+static const int ASPIRATION_MAX_WINDOW = 1000;
+static const int STOP_POLL_INTERVAL = 1024;
+static const uint64_t NO_PONDER_HIT = 0xFFFFFFFFFFFFFFFFULL;
+static int reductionTable[64][64];
 
 void Engine::InitializeEngine()
 {
@@ -52,42 +83,223 @@ void Engine::InitializeEngine()
 	maxSearchDepth = 10000;
 
 	Position::SetPosition(currentPosition, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+	TranspositionTable::Clear();
+
+	for (auto it = searchThreads.begin(); it != searchThreads.end(); it++)
+	{
+		MoveOrdering::ClearHeuristics((*it)->Heuristics);
+	}
+
+	// reductions grow with the log of both the remaining depth and the move number
+
+	for (int depth = 1; depth < 64; depth++)
+	{
+		for (int moveNumber = 1; moveNumber < 64; moveNumber++)
+		{
+			reductionTable[depth][moveNumber] = static_cast<int>(0.75 + std::log(depth) * std::log(moveNumber) / 2.25);
+		}
+	}
 }
 
-std::string Engine::GetRandomMove(Board& position)
+void Engine::SetThreadCount(int count)
 {
-	std::vector<Move> availableMoves = MoveGenerator::GenerateMoves(position);
-	std::string result;
+	std::stringstream logText;
+
+	searchThreads.clear();
 
-	if (availableMoves.size() > 0)
+	for (int i = 0; i < count; i++)
 	{
-		std::default_random_engine generator(static_cast<unsigned int>(std::time(0)));
-		std::uniform_int_distribution<> dist(0, static_cast<int>(availableMoves.size() - 1));
+		searchThreads.emplace_back(new SearchThread());
+		searchThreads.back()->Id = i;
+		MoveOrdering::ClearHeuristics(searchThreads.back()->Heuristics);
+	}
 
-		Move move = availableMoves[dist(generator)];
+	logText << "search threads: " << count;
+	Logger::Write(LogLevel::Info, logText.str());
+}
 
-		Position::Make(position, move);
-		result = Utility::GenerateXBoardNotation(move);
+// the pv at a ply is its best move followed by the pv of the ply below
+static void UpdatePV(PVTable& pv, int ply, Move move)
+{
+	int childLength;
+
+	if (ply >= PVTable::MAX_PLY)
+	{
+		return;
 	}
-	else
+
+	pv.Moves[ply][0] = move;
+	pv.Length[ply] = 1;
+
+	if (ply + 1 < PVTable::MAX_PLY)
 	{
-		result = "";
+		childLength = std::min(pv.Length[ply + 1], PVTable::MAX_PLY - ply - 1);
+
+		std::memcpy(&pv.Moves[ply][1], &pv.Moves[ply + 1][0], childLength * sizeof(Move));
+		pv.Length[ply] += childLength;
 	}
+}
 
-	return result;
+// the shared stop flag, and on the main thread the clock, are only looked at every
+// STOP_POLL_INTERVAL nodes; in between the thread goes by its last answer
+static bool IsStopped(SearchThread& thread)
+{
+	if (--thread.PollCountdown <= 0)
+	{
+		thread.PollCountdown = STOP_POLL_INTERVAL;
+
+		if (thread.Id == 0 && searchDeadlineActive && !pondering.load()
+			&& std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - searchStart).count()
+				>= searchDeadline.load())
+		{
+			stopSearch.store(true);
+		}
+
+		thread.Stopped = stopSearch.load(std::memory_order_relaxed);
+	}
+
+	return thread.Stopped;
 }
 
-std::string Engine::GetMove(Board& position, TimeControl& clock)
+static void RunSearchWorker(Board position, TimeControl clock)
 {
-	Move move = SearchRoot(position, clock);
-	std::string result = "";
+	searchResult = Engine::SearchRoot(position, clock);
+	searchFinished.store(true);
 
-	if (move.TargetLocation != 0)
+	if (searchFinishedHandler != nullptr)
 	{
-		Position::Make(position, move);
+		searchFinishedHandler();
+	}
+}
+
+void Engine::SetSearchFinishedHandler(void (*handler)())
+{
+	searchFinishedHandler = handler;
+}
+
+void Engine::StartSearch(Board& position, TimeControl& clock)
+{
+	stopSearch.store(false);
+	searchFinished.store(false);
+	pondering.store(false);
+
+	// the worker gets its own copies, so the interface is free to change the originals
+
+	searchWorker = std::thread(RunSearchWorker, position, clock);
+}
+
+// a ponder search runs on the position after the predicted reply with no regard for the
+// clock, until a ponder hit turns it into the real search or it is stopped
+void Engine::StartPonder(Board& position, TimeControl& clock)
+{
+	pondering.store(true);
+	stopSearch.store(false);
+	searchFinished.store(false);
+
+	searchWorker = std::thread(RunSearchWorker, position, clock);
+}
+
+// clearing the flag under the lock means a ponder search about to wait for the end of
+// pondering either sees it or gets woken
+static void EndPondering()
+{
+	ponderMutex.lock();
+	pondering.store(false);
+	ponderMutex.unlock();
+
+	ponderEnded.notify_all();
+}
+
+// the search keeps its tree and its start time, so the time spent pondering counts
+// towards the move it now has to produce. the time for that move is planned from the
+// clock as it is now, not as it was when pondering began
+void Engine::PonderHit(Board& position, TimeControl& clock)
+{
+	uint64_t availableSearchTime = GetAvailableSearchTime(clock, position);
+
+	searchDeadline.store(availableSearchTime * 30);
+	ponderHitSearchTime.store(availableSearchTime);
+	EndPondering();
+
+	TUXEDOCAT_LOG_DEBUG("ponder hit, available time for search: " << availableSearchTime);
+}
+
+bool Engine::IsPondering()
+{
+	return pondering.load();
+}
+
+Move Engine::GetPonderMove()
+{
+	return ponderMove;
+}
+
+void Engine::StopSearch()
+{
+	stopSearch.store(true);
+	EndPondering();
+}
+
+bool Engine::IsSearching()
+{
+	return searchWorker.joinable();
+}
+
+bool Engine::IsSearchFinished()
+{
+	return searchFinished.load();
+}
+
+Move Engine::WaitForSearch()
+{
+	if (searchWorker.joinable())
+	{
+		searchWorker.join();
+	}
+
+	return searchResult;
+}
+
+// helpers search the root to ever greater depths with full windows until the main thread
+// is done; the results reach the main thread only through the transposition table. odd
+// helpers start a ply deeper so the threads don't all work on the same iteration
+static void HelperSearch(SearchThread* thread)
+{
+	for (int depth = 1 + thread->Id % 2; depth <= maxSearchDepth && depth < PVTable::MAX_PLY; depth++)
+	{
+		Engine::Search(*thread, depth, -INFINITE_SCORE, INFINITE_SCORE, 0, MoveUtil::GetNullMove());
+
+		if (thread->Stopped)
+		{
+			break;
+		}
+	}
+}
+
+std::string Engine::GetRandomMove(Board& position)
+{
+	MoveList availableMoves;
+	std::string result;
+
+	MoveGenerator::GenerateMoves(position, availableMoves);
+
+	if (availableMoves.Count > 0)
+	{
+		std::default_random_engine generator(static_cast<unsigned int>(std::time(0)));
+		std::uniform_int_distribution<> dist(0, availableMoves.Count - 1);
+
+		Move move = availableMoves.Moves[dist(generator)];
+		UndoInfo undo;
+
+		Position::Make(position, move, undo);
 		result = Utility::GenerateXBoardNotation(move);
 	}
-	
+	else
+	{
+		result = "";
+	}
+
 	return result;
 }
 
@@ -97,6 +309,7 @@ int Engine::EvaluatePosition(Board& position)
 	int sideToMoveFactor = 0;
 	uint64_t whitePassedPawns;
 	uint64_t blackPassedPawns;
+	MoveList bishopMoves;
 
 	if (position.ColorToMove == PieceColor::WHITE)
 	{
@@ -136,7 +349,8 @@ int Engine::EvaluatePosition(Board& position)
 
 	// bishop mobility
 
-	score += (static_cast<int>(MoveGenerator::GenerateMoves(position, PieceRank::BISHOP).size()));
+	MoveGenerator::GenerateMoves(position, bishopMoves, PieceRank::BISHOP);
+	score += bishopMoves.Count;
 
 	return (score * sideToMoveFactor);
 }
@@ -197,127 +411,244 @@ uint64_t Engine::GetAvailableSearchTime(TimeControl& clock, Board& position)
 	return availableTime;
 }
 
-std::string Engine::BuildPVString()
+std::string Engine::BuildPVString(SearchThread& thread)
 {
 	std::stringstream ss;
 
-	if (pvArrays.size() > 0)
+	for (int i = 0; i < thread.PV.Length[0]; i++)
 	{
-		for (auto it = pvArrays[0].begin(); it != pvArrays[0].end(); it++)
-		{
-			ss << " " << Utility::GenerateXBoardNotation(*it);
-		}
+		ss << " " << Utility::GenerateXBoardNotation(thread.PV.Moves[0][i]);
 	}
 
 	return ss.str();
 }
 
-Move Engine::SearchRoot(Board& position, TimeControl& clock)
+Move Engine::SearchRoot(Board& rootPosition, TimeControl& clock)
 {
+	SearchThread& mainThread = *searchThreads[0];
+	Board& position = mainThread.Position;
+	std::vector<std::thread> helpers;
 	int depth = 1;
-	std::vector<Move> availableMoves;
+	MoveList availableMoves;
 	Move bestMove;
+	UndoInfo undo;
 	std::default_random_engine generator(static_cast<unsigned int>(std::time(0)));
 	std::uniform_int_distribution<> dist(-10, 10);
 	std::chrono::high_resolution_clock::time_point start;
 	std::chrono::high_resolution_clock::time_point currentTime;
 	std::chrono::milliseconds elapsedTime;
 	uint64_t availableSearchTime;
+	uint64_t ponderHitTime;
 	uint64_t predictedSearchTime;
 	uint64_t nodeCountAtBeginningOfIteration;
 	uint64_t nodeCountOfPreviousIteration;
 	uint64_t nodeCountOfCurrentIteration;
 	uint64_t predictedNodesOfNextIteration;
 	uint64_t effectiveBranchingFactor;
-	uint64_t branchingFactorSum;
+	uint64_t branchingFactorSum = 0;
 	long long msecs;
 	uint64_t nodesPerMillisecond;
 	std::stringstream logText;
 	int alpha;
-
-	availableSearchTime = GetAvailableSearchTime(clock, position);
+	int windowAlpha;
+	int windowBeta;
+	int delta;
+	int currentScore;
+	int previousScore = 0;
+	bool stillPondering;
+
+	availableSearchTime = GetAvailableSearchTime(clock, rootPosition);
 	predictedSearchTime = 0;
-	nodeCount = 0;
 	nodeCountOfPreviousIteration = 0;
 
 	start = std::chrono::high_resolution_clock::now();
 
-	logText << "available time for search: " << availableSearchTime;
-	Utility::WriteLog(logText.str());
-	logText.clear();
-	logText.str("");
+	TranspositionTable::NewSearch();
+
+	for (auto it = searchThreads.begin(); it != searchThreads.end(); it++)
+	{
+		(*it)->Position = rootPosition;
+		(*it)->NodeCount = 0;
+		(*it)->QuiescenceNodeCount = 0;
+		(*it)->PV.Length[0] = 0;
+		(*it)->Stopped = false;
+		(*it)->PollCountdown = STOP_POLL_INTERVAL;
+		MoveOrdering::AgeHeuristics((*it)->Heuristics);
+	}
+
+	// past three times the planned time an iteration is cut off; depth 1 always completes
+	// so there is a move to play
 
-	bestMove.TargetLocation = 0;
-	availableMoves = MoveGenerator::GenerateMoves(position);
-	std::sort(availableMoves.begin(), availableMoves.end(), MoveUtil::compareMoves);
+	searchStart = start;
+	searchDeadline.store(availableSearchTime * 30);
+	ponderHitSearchTime.store(NO_PONDER_HIT);
+	searchDeadlineActive = false;
+
+	for (auto it = searchThreads.begin() + 1; it != searchThreads.end(); it++)
+	{
+		helpers.emplace_back(HelperSearch, it->get());
+	}
+
+	TUXEDOCAT_LOG_DEBUG("available time for search: " << availableSearchTime);
+
+	bestMove = MoveUtil::GetNullMove();
+	MoveGenerator::GenerateMoves(position, availableMoves);
+	std::sort(availableMoves.Moves, availableMoves.Moves + availableMoves.Count, MoveUtil::compareMoves);
 
 	do
 	{
-		nodeCountAtBeginningOfIteration = nodeCount;
-		alpha = -3000000;
-		currentMaxDepth = depth;
+		nodeCountAtBeginningOfIteration = mainThread.NodeCount + mainThread.QuiescenceNodeCount;
 
-		std::vector<Move> newLevelVector;
-		pvArrays.push_back(newLevelVector);
+		// once the score has settled, search in a window around the previous one and
+		// only widen it when the result falls outside
 
-		if (pvArrays[0].size() > 0)
-		{
-			auto it = std::find(availableMoves.begin(), availableMoves.end(), pvArrays[0][0]);
+		delta = ASPIRATION_WINDOW;
 
-			availableMoves.erase(it);
-			availableMoves.insert(availableMoves.begin(), pvArrays[0][0]);
+		if (depth >= ASPIRATION_MIN_DEPTH && !randomMode && previousScore > -MATE_BOUND && previousScore < MATE_BOUND)
+		{
+			windowAlpha = previousScore - delta;
+			windowBeta = previousScore + delta;
 		}
-
-		for (auto it = pvArrays.begin(); it != pvArrays.end(); it++)
+		else
 		{
-			it->clear();
+			windowAlpha = -INFINITE_SCORE;
+			windowBeta = INFINITE_SCORE;
 		}
 
-		for (auto it = availableMoves.begin(); it != availableMoves.end(); it++)
+		while (true)
 		{
-			Position::Make(position, *it);
-			nodeCount++;
-
-			currentBestScore = -Search(position, depth - 1);
-
-			Position::Unmake(position, *it);
+			alpha = windowAlpha;
 
-			if (randomMode)
+			if (!MoveUtil::IsNullMove(bestMove))
 			{
-				currentBestScore += dist(generator);
+				Move* it = std::find(availableMoves.Moves, availableMoves.Moves + availableMoves.Count, bestMove);
+
+				std::rotate(availableMoves.Moves, it, it + 1);
 			}
 
-			if (currentBestScore > alpha)
+			for (Move* it = availableMoves.Moves; it != availableMoves.Moves + availableMoves.Count; it++)
 			{
-				alpha = currentBestScore;
-				bestMove = *it;
+				Position::Make(position, *it, undo);
+				mainThread.NodeCount++;
 
-				pvArrays[0].clear();
-				pvArrays[0].push_back(*it);
+				// random mode perturbs the scores afterwards, so it needs exact ones for every move
 
-				if (pvArrays.size() > 1)
+				if (randomMode)
+				{
+					currentScore = -Search(mainThread, depth - 1, -INFINITE_SCORE, INFINITE_SCORE, 1, *it);
+				}
+				else if (it == availableMoves.Moves)
 				{
-					pvArrays[0].insert(pvArrays[0].end(), pvArrays[1].begin(), pvArrays[1].end());
+					currentScore = -Search(mainThread, depth - 1, -windowBeta, -alpha, 1, *it);
 				}
+				else
+				{
+					currentScore = -Search(mainThread, depth - 1, -alpha - 1, -alpha, 1, *it);
+
+					if (currentScore > alpha && currentScore < windowBeta)
+					{
+						currentScore = -Search(mainThread, depth - 1, -windowBeta, -alpha, 1, *it);
+					}
+				}
+
+				Position::Unmake(position, *it, undo);
+
+				// an aborted search returns nothing usable; what the moves before found stands
+
+				if (mainThread.Stopped)
+				{
+					break;
+				}
+
+				if (randomMode)
+				{
+					currentScore += dist(generator);
+				}
+
+				if (currentScore > alpha)
+				{
+					alpha = currentScore;
+					bestMove = *it;
+
+					UpdatePV(mainThread.PV, 0, *it);
+
+					if (alpha >= windowBeta)
+					{
+						break;
+					}
+
+					currentTime = std::chrono::high_resolution_clock::now();
+					elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - start);
+					msecs = elapsedTime.count();
+
+					if (showThinkingOutput)
+					{
+						logText << depth << " " << alpha << " " << msecs / 10 << " " << mainThread.NodeCount + mainThread.QuiescenceNodeCount
+							<< BuildPVString(mainThread);
+						std::cout << logText.str() << std::endl;
+						Logger::Write(LogLevel::Info, logText.str());
+						logText.clear();
+						logText.str("");
+					}
+				}
+			}
+
+			if (mainThread.Stopped)
+			{
+				break;
+			}
+
+			// the score is only a bound when the window failed: report it as one, marking
+			// the pv with ! for a fail high and ? for a fail low, and search again wider
+
+			if (alpha > windowAlpha && alpha < windowBeta)
+			{
+				break;
+			}
 
+			if (showThinkingOutput)
+			{
 				currentTime = std::chrono::high_resolution_clock::now();
 				elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - start);
 				msecs = elapsedTime.count();
 
-				if (showThinkingOutput)
-				{
-					logText << depth << " " << alpha << " " << msecs / 10 << " " << nodeCount << BuildPVString();
-					std::cout << logText.str() << std::endl;
-					Utility::WriteLog(logText.str());
-					logText.clear();
-					logText.str("");
-				}
+				logText << depth << " " << (alpha >= windowBeta ? windowBeta : windowAlpha) << " " << msecs / 10 << " "
+					<< mainThread.NodeCount + mainThread.QuiescenceNodeCount << BuildPVString(mainThread) << (alpha >= windowBeta ? "!" : "?");
+				std::cout << logText.str() << std::endl;
+				Logger::Write(LogLevel::Info, logText.str());
+				logText.clear();
+				logText.str("");
 			}
+
+			if (windowAlpha == -INFINITE_SCORE && windowBeta == INFINITE_SCORE)
+			{
+				break;
+			}
+
+			if (alpha >= windowBeta)
+			{
+				windowBeta = delta > ASPIRATION_MAX_WINDOW ? INFINITE_SCORE : std::min(alpha + delta, INFINITE_SCORE);
+			}
+			else
+			{
+				windowAlpha = delta > ASPIRATION_MAX_WINDOW ? -INFINITE_SCORE : std::max(alpha - delta, -INFINITE_SCORE);
+			}
+
+			delta *= 2;
 		}
 
+		if (mainThread.Stopped)
+		{
+			TUXEDOCAT_LOG_DEBUG("search stopped");
+			break;
+		}
+
+		previousScore = alpha;
+		searchDeadlineActive = true;
+
 		// calculate predicted time of next iteration
 
-		nodeCountOfCurrentIteration = nodeCount - nodeCountAtBeginningOfIteration;
+		nodeCountOfCurrentIteration = mainThread.NodeCount + mainThread.QuiescenceNodeCount - nodeCountAtBeginningOfIteration;
 
 		if (nodeCountOfPreviousIteration == 0)
 		{
@@ -343,7 +674,7 @@ Move Engine::SearchRoot(Board& position, TimeControl& clock)
 		}
 		else
 		{
-			nodesPerMillisecond = nodeCount / msecs;
+			nodesPerMillisecond = (mainThread.NodeCount + mainThread.QuiescenceNodeCount) / msecs;
 
 			if (availableSearchTime > static_cast<uint64_t>(msecs / 10))
 			{
@@ -362,73 +693,474 @@ Move Engine::SearchRoot(Board& position, TimeControl& clock)
 
 		predictedSearchTime = (predictedNodesOfNextIteration / (nodesPerMillisecond * 10)) + (msecs / 10);
 
-		logText << "elapsed time: " << msecs / 10 << "cs, predicted time: " << predictedSearchTime << "cs, effective branching factor: " << effectiveBranchingFactor;
-		Utility::WriteLog(logText.str());
-		logText.clear();
-		logText.str("");
+		TUXEDOCAT_LOG_DEBUG("elapsed time: " << msecs / 10 << "cs, predicted time: " << predictedSearchTime << "cs, effective branching factor: " << effectiveBranchingFactor
+			<< ", nodes: " << mainThread.NodeCount << " main, " << mainThread.QuiescenceNodeCount << " quiescence");
 
 		depth++;
 
-		if (depth > maxSearchDepth)
+		if (depth > maxSearchDepth || depth >= PVTable::MAX_PLY)
 		{
 			break;
 		}
-	} while (predictedSearchTime < availableSearchTime);
 
-	pvArrays.clear();
+		// a ponder hit replaces the time planned when pondering began. the hit publishes
+		// its time before it clears the flag, so reading the flag first can't miss it
+
+		stillPondering = pondering.load();
+		ponderHitTime = ponderHitSearchTime.exchange(NO_PONDER_HIT);
+
+		if (ponderHitTime != NO_PONDER_HIT)
+		{
+			availableSearchTime = ponderHitTime;
+		}
+	} while (stillPondering || predictedSearchTime < availableSearchTime);
+
+	// a move may not be sent before the opponent has made theirs, so a ponder search
+	// that runs out of depth waits for the hit or the stop
+
+	{
+		std::unique_lock<std::mutex> lock(ponderMutex);
+
+		ponderEnded.wait(lock, [] { return !pondering.load(); });
+	}
+
+	stopSearch.store(true);
+
+	if (MoveUtil::IsNullMove(bestMove) && availableMoves.Count > 0)
+	{
+		bestMove = availableMoves.Moves[0];
+	}
+
+	// the reply to ponder on is the second pv move, or failing that the hash move of the
+	// position after the best move
+
+	ponderMove = MoveUtil::GetNullMove();
+
+	if (mainThread.PV.Length[0] >= 2 && mainThread.PV.Moves[0][0] == bestMove)
+	{
+		ponderMove = mainThread.PV.Moves[0][1];
+	}
+	else if (!MoveUtil::IsNullMove(bestMove))
+	{
+		HashEntry entry;
+
+		Position::Make(position, bestMove, undo);
+
+		if (TranspositionTable::Probe(position.HashKey, entry) && MoveGenerator::IsLegalMove(position, entry.BestMove))
+		{
+			ponderMove = entry.BestMove;
+		}
+
+		Position::Unmake(position, bestMove, undo);
+	}
+
+	for (auto it = helpers.begin(); it != helpers.end(); it++)
+	{
+		it->join();
+	}
+
+	if (searchThreads.size() > 1)
+	{
+		uint64_t totalNodes = 0;
+
+		for (auto it = searchThreads.begin(); it != searchThreads.end(); it++)
+		{
+			totalNodes += (*it)->NodeCount + (*it)->QuiescenceNodeCount;
+		}
+
+		TUXEDOCAT_LOG_DEBUG("threads: " << searchThreads.size() << ", total nodes: " << totalNodes);
+	}
 
 	return bestMove;	
 }
 
-int Engine::Search(Board& position, int depth)
+static bool HasNonPawnMaterial(Board& position, PieceColor color)
+{
+	if (color == PieceColor::WHITE)
+	{
+		return (position.WhiteKnights | position.WhiteBishops | position.WhiteRooks | position.WhiteQueens) != 0;
+	}
+
+	return (position.BlackKnights | position.BlackBishops | position.BlackRooks | position.BlackQueens) != 0;
+}
+
+// mate scores are stored relative to the node rather than the root, so they stay valid
+// wherever the position turns up again
+
+static int ScoreToHash(int score, int ply)
 {
+	if (score >= MATE_BOUND)
+	{
+		return score + ply;
+	}
+	else if (score <= -MATE_BOUND)
+	{
+		return score - ply;
+	}
+
+	return score;
+}
+
+static int ScoreFromHash(int score, int ply)
+{
+	if (score >= MATE_BOUND)
+	{
+		return score - ply;
+	}
+	else if (score <= -MATE_BOUND)
+	{
+		return score + ply;
+	}
+
+	return score;
+}
+
+int Engine::Search(SearchThread& thread, int depth, int alpha, int beta, int ply, Move previousMove)
+{
+	Board& position = thread.Position;
 	int currentScore = 0;
-	std::vector<Move> availableMoves;
-	int max = -3000000;
+	int bestScore = -INFINITE_SCORE;
+	int originalAlpha = alpha;
+	int moveCount = 0;
+	int quietCount = 0;
+	bool isPVNode = beta - alpha > 1;
+	MovePicker picker;
+	Move quietsTried[MoveList::CAPACITY];
+	Move move;
+	Move hashMove = MoveUtil::GetNullMove();
+	Move bestMove = MoveUtil::GetNullMove();
+	HashEntry hashEntry;
+	UndoInfo undo;
+	BoundType bound;
+	uint64_t king;
+	bool inCheck;
+
+	// a stopped search unwinds without storing anything
+
+	if (IsStopped(thread))
+	{
+		return 0;
+	}
 
-	if (depth == 0)
+	// whatever an earlier sibling left at this ply isn't part of this node's pv
+
+	if (ply < PVTable::MAX_PLY)
 	{
-		return EvaluatePosition(position);
+		thread.PV.Length[ply] = 0;
 	}
-	else
+
+	if (depth <= 0)
+	{
+		return Quiescence(thread, alpha, beta, ply);
+	}
+
+	if (TranspositionTable::Probe(position.HashKey, hashEntry))
+	{
+		int hashScore = ScoreFromHash(hashEntry.Score, ply);
+
+		hashMove = hashEntry.BestMove;
+
+		// cutting off at pv nodes would cut the pv short, so those only use the move
+
+		if (!isPVNode && hashEntry.Depth >= depth
+			&& (hashEntry.Bound == BoundType::EXACT
+				|| (hashEntry.Bound == BoundType::LOWER && hashScore >= beta)
+				|| (hashEntry.Bound == BoundType::UPPER && hashScore <= alpha)))
+		{
+			return hashScore;
+		}
+	}
+
+	king = position.ColorToMove == PieceColor::WHITE ? position.WhiteKing : position.BlackKing;
+	inCheck = MoveGenerator::IsSquareAttacked(king, position);
+
+	// a null previous move means this node follows a null move or verifies one, so it
+	// doesn't get another; with only pawns left zugzwang is too likely for passing to be safe
+
+	if (!isPVNode && !inCheck && depth >= NULL_MOVE_MIN_DEPTH && !MoveUtil::IsNullMove(previousMove)
+		&& HasNonPawnMaterial(position, position.ColorToMove) && EvaluatePosition(position) >= beta)
 	{
-		availableMoves = MoveGenerator::GenerateMoves(position);
-		std::sort(availableMoves.begin(), availableMoves.end(), MoveUtil::compareMoves);
+		int reduction = 3 + depth / 6;
+		int nullDepth = std::max(depth - 1 - reduction, 0);
+		int verificationScore;
+		Move nullMove = MoveUtil::GetNullMove();
 
-		if (availableMoves.size() > 0)
+		Position::Make(position, nullMove, undo);
+		thread.NodeCount++;
+		currentScore = -Search(thread, nullDepth, -beta, -beta + 1, ply + 1, nullMove);
+		Position::Unmake(position, nullMove, undo);
+
+		if (thread.Stopped)
 		{
-			for (auto it = availableMoves.begin(); it != availableMoves.end(); it++)
+			return 0;
+		}
+
+		if (currentScore >= beta)
+		{
+			// a mate found after passing isn't a real mate
+
+			if (currentScore >= MATE_BOUND)
 			{
-				Position::Make(position, *it);
-				nodeCount++;
+				currentScore = beta;
+			}
 
-				currentScore = -Search(position, depth - 1);
+			if (depth < NULL_MOVE_VERIFICATION_DEPTH)
+			{
+				return currentScore;
+			}
 
-				Position::Unmake(position, *it);
+			verificationScore = Search(thread, nullDepth, beta - 1, beta, ply, MoveUtil::GetNullMove());
 
-				if (currentScore > max)
+			if (thread.Stopped)
+			{
+				return 0;
+			}
+
+			if (verificationScore >= beta)
+			{
+				return currentScore;
+			}
+		}
+	}
+
+	MoveOrdering::InitializePicker(picker, hashMove, &thread.Heuristics, ply, previousMove);
+
+	while (MoveOrdering::GetNextMove(picker, position, move))
+	{
+		bool isQuiet = MoveUtil::GetCapturedPiece(move) == PieceRank::NONE
+			&& MoveUtil::GetPromotedRank(move) == PieceRank::NONE;
+		bool givesCheck;
+
+		// late quiet moves at shallow non-pv nodes are almost never the ones that matter.
+		// they're dropped before being made, so the check test works on the board as it is
+
+		if (lateMoveReductions && !isPVNode && !inCheck && isQuiet && depth <= LATE_MOVE_PRUNING_DEPTH
+			&& moveCount >= 3 + depth * depth && bestScore > -MATE_BOUND
+			&& !MoveGenerator::GivesCheck(position, move))
+		{
+			continue;
+		}
+
+		Position::Make(position, move, undo);
+
+		king = position.ColorToMove == PieceColor::WHITE ? position.WhiteKing : position.BlackKing;
+		givesCheck = MoveGenerator::IsSquareAttacked(king, position);
+
+		thread.NodeCount++;
+		moveCount++;
+
+		if (moveCount == 1)
+		{
+			currentScore = -Search(thread, depth - 1, -beta, -alpha, ply + 1, move);
+		}
+		else
+		{
+			int reduction = 0;
+
+			// quiet moves this far down the ordering are searched shallower first and only
+			// get the full depth back when they beat alpha anyway
+
+			if (lateMoveReductions && depth >= 3 && moveCount > 3 && isQuiet && !inCheck && !givesCheck)
+			{
+				reduction = reductionTable[std::min(depth, 63)][std::min(moveCount, 63)];
+
+				if (isPVNode || move == picker.Killers[0] || move == picker.Killers[1])
 				{
-					pvArrays[currentMaxDepth - depth].clear();
-					pvArrays[currentMaxDepth - depth].push_back(*it);
+					reduction--;
+				}
 
-					if (static_cast<int>(pvArrays.size()) > ((currentMaxDepth - depth) + 1))
+				reduction = std::max(0, std::min(reduction, depth - 2));
+			}
+
+			// later moves only have to prove they're no better than the first; search
+			// again with the full window when one is
+
+			currentScore = -Search(thread, depth - 1 - reduction, -alpha - 1, -alpha, ply + 1, move);
+
+			if (reduction > 0 && currentScore > alpha)
+			{
+				currentScore = -Search(thread, depth - 1, -alpha - 1, -alpha, ply + 1, move);
+			}
+
+			if (currentScore > alpha && currentScore < beta)
+			{
+				currentScore = -Search(thread, depth - 1, -beta, -alpha, ply + 1, move);
+			}
+		}
+
+		Position::Unmake(position, move, undo);
+
+		// a stopped child's score means nothing, and must not reach the pv, the
+		// heuristics or the shared hash table
+
+		if (thread.Stopped)
+		{
+			return 0;
+		}
+
+		if (currentScore > bestScore)
+		{
+			bestScore = currentScore;
+			bestMove = move;
+
+			if (currentScore > alpha)
+			{
+				alpha = currentScore;
+
+				UpdatePV(thread.PV, ply, move);
+
+				if (alpha >= beta)
+				{
+					if (isQuiet)
 					{
-						pvArrays[currentMaxDepth - depth].insert(pvArrays[currentMaxDepth - depth].end(),
-							pvArrays[(currentMaxDepth - depth) + 1].begin(), pvArrays[(currentMaxDepth - depth) + 1].end());
+						MoveOrdering::UpdateQuietHeuristics(thread.Heuristics, move, previousMove, ply, depth, quietsTried,
+							quietCount);
 					}
 
-					max = currentScore;
+					break;
+				}
+			}
+		}
+
+		if (isQuiet)
+		{
+			quietsTried[quietCount++] = move;
+		}
+	}
+
+	if (moveCount == 0)
+	{
+		return inCheck ? -MATE_SCORE + ply : 0;
+	}
+
+	if (bestScore <= originalAlpha)
+	{
+		bound = BoundType::UPPER;
+	}
+	else if (bestScore >= beta)
+	{
+		bound = BoundType::LOWER;
+	}
+	else
+	{
+		bound = BoundType::EXACT;
+	}
+
+	TranspositionTable::Store(position.HashKey, depth, bound, ScoreToHash(bestScore, ply), bestMove);
+
+	return bestScore;
+}
+
+int Engine::Quiescence(SearchThread& thread, int alpha, int beta, int ply)
+{
+	Board& position = thread.Position;
+	int currentScore;
+	int bestScore = -INFINITE_SCORE;
+	int standPat = 0;
+	int moveCount = 0;
+	uint64_t king = position.ColorToMove == PieceColor::WHITE ? position.WhiteKing : position.BlackKing;
+	bool inCheck = MoveGenerator::IsSquareAttacked(king, position);
+	MovePicker picker;
+	Move move;
+	UndoInfo undo;
+
+	if (IsStopped(thread))
+	{
+		return 0;
+	}
+
+	// checking evasions can keep answering each other, so the line is cut off where the
+	// pv table ends
+
+	if (ply >= PVTable::MAX_PLY)
+	{
+		return EvaluatePosition(position);
+	}
+
+	if (inCheck)
+	{
+		// no standing pat in check: every evasion is tried, and having none is mate
+
+		MoveOrdering::InitializePicker(picker, MoveUtil::GetNullMove(), nullptr, 0, MoveUtil::GetNullMove());
+	}
+	else
+	{
+		standPat = EvaluatePosition(position);
+
+		if (standPat >= beta)
+		{
+			return standPat;
+		}
+
+		if (standPat > alpha)
+		{
+			alpha = standPat;
+		}
+
+		bestScore = standPat;
+
+		MoveOrdering::InitializeCapturePicker(picker);
+	}
+
+	while (MoveOrdering::GetNextMove(picker, position, move))
+	{
+		moveCount++;
+
+		if (!inCheck && MoveUtil::GetPromotedRank(move) == PieceRank::NONE)
+		{
+			// delta pruning: even winning the piece outright with some margin to spare
+			// wouldn't get this node back up to alpha
+
+			if (standPat + MoveOrdering::GetPieceValue(MoveUtil::GetCapturedPiece(move)) + DELTA_MARGIN <= alpha)
+			{
+				continue;
+			}
+
+			if (seePruning && MoveOrdering::GetStaticExchange(position, move) < 0)
+			{
+				continue;
+			}
+		}
+
+		Position::Make(position, move, undo);
+		thread.QuiescenceNodeCount++;
+
+		currentScore = -Quiescence(thread, -beta, -alpha, ply + 1);
+
+		Position::Unmake(position, move, undo);
+
+		if (thread.Stopped)
+		{
+			return 0;
+		}
+
+		if (currentScore > bestScore)
+		{
+			bestScore = currentScore;
+
+			if (currentScore > alpha)
+			{
+				alpha = currentScore;
+
+				if (alpha >= beta)
+				{
+					break;
 				}
 			}
 		}
+	}
 
-		return max;
+	if (inCheck && moveCount == 0)
+	{
+		return -MATE_SCORE + ply;
 	}
+
+	return bestScore;
 }
 
 bool Engine::IsGameOver(Board& position)
 {
-	if (MoveGenerator::GenerateMoves(position).size() == 0)
+	if (MoveGenerator::CountLegalMoves(position) == 0)
 	{
 		return true;
 	}
@@ -463,36 +1195,111 @@ std::string Engine::GetGameResult(Board& position)
 
 uint64_t Engine::Perft(Board& position, int depth)
 {
+	MoveList availableMoves;
+	UndoInfo undo;
+
+	// the last ply only needs counting, which doesn't require building the moves
+
 	if (depth <= 1)
 	{
-		return static_cast<uint64_t>(MoveGenerator::GenerateMoves(position).size());
+		return static_cast<uint64_t>(MoveGenerator::CountLegalMoves(position));
 	}
 	else
 	{
 		uint64_t count = 0;
-		std::vector<Move> availableMoves = MoveGenerator::GenerateMoves(position);
 
-		for (auto it = availableMoves.cbegin(); it != availableMoves.cend(); it++)
+		MoveGenerator::GenerateMoves(position, availableMoves);
+
+		for (Move* it = availableMoves.Moves; it != availableMoves.Moves + availableMoves.Count; it++)
 		{
-			Position::Make(position, *it);
+			Position::Make(position, *it, undo);
 			count += Perft(position, depth - 1);
-			Position::Unmake(position, *it);
+			Position::Unmake(position, *it, undo);
 		}
 
 		return count;
 	}
 }
 
+// a perft subtree count; depth 0 marks an empty entry
+struct PerftEntry
+{
+	uint64_t Key;
+	uint64_t Count;
+	int Depth;
+};
+
+static std::vector<PerftEntry> perftTable;
+
+static uint64_t HashedPerftNode(Board& position, int depth)
+{
+	MoveList availableMoves;
+	UndoInfo undo;
+	uint64_t count = 0;
+
+	// counting the last ply is cheaper than looking it up
+
+	if (depth <= 1)
+	{
+		return static_cast<uint64_t>(MoveGenerator::CountLegalMoves(position));
+	}
+
+	PerftEntry& entry = perftTable[position.HashKey & (perftTable.size() - 1)];
+
+	if (entry.Key == position.HashKey && entry.Depth == depth)
+	{
+		return entry.Count;
+	}
+
+	MoveGenerator::GenerateMoves(position, availableMoves);
+
+	for (Move* it = availableMoves.Moves; it != availableMoves.Moves + availableMoves.Count; it++)
+	{
+		Position::Make(position, *it, undo);
+		count += HashedPerftNode(position, depth - 1);
+		Position::Unmake(position, *it, undo);
+	}
+
+	entry.Key = position.HashKey;
+	entry.Count = count;
+	entry.Depth = depth;
+
+	return count;
+}
+
+uint64_t Engine::HashedPerft(Board& position, int depth, uint64_t megabytes)
+{
+	uint64_t entryCount = 1;
+	uint64_t count;
+
+	while (entryCount * 2 * sizeof(PerftEntry) <= megabytes * 1024 * 1024)
+	{
+		entryCount *= 2;
+	}
+
+	perftTable.assign(entryCount, PerftEntry{ 0, 0, 0 });
+
+	count = HashedPerftNode(position, depth);
+
+	perftTable.clear();
+	perftTable.shrink_to_fit();
+
+	return count;
+}
+
 void Engine::Divide(Board& position, int depth)
 {
 	uint64_t totalCount = 0;
 	int moveCount = 0;
-	std::vector<Move> availableMoves = MoveGenerator::GenerateMoves(position);
+	MoveList availableMoves;
+	UndoInfo undo;
 	std::stringstream output;
 
+	MoveGenerator::GenerateMoves(position, availableMoves);
+
 	if (depth <= 1)
 	{
-		for (auto it = availableMoves.cbegin(); it != availableMoves.cend(); it++)
+		for (Move* it = availableMoves.Moves; it != availableMoves.Moves + availableMoves.Count; it++)
 		{
 			moveCount++;
 			totalCount++;
@@ -500,24 +1307,26 @@ void Engine::Divide(Board& position, int depth)
 			output << Utility::GenerateSAN(position, *it, availableMoves) << ": 1";
 			std::cout << output.str() << std::endl;
 
-			Utility::WriteLog("engine -> interface: " + output.str());
+			Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
 		}
 	}
 	else
 	{
-		for (auto it = availableMoves.cbegin(); it != availableMoves.cend(); it++)
+		for (Move* it = availableMoves.Moves; it != availableMoves.Moves + availableMoves.Count; it++)
 		{
 			moveCount++;
 
-			Position::Make(position, *it);
+			std::string san = Utility::GenerateSAN(position, *it, availableMoves);
+
+			Position::Make(position, *it, undo);
 
 			uint64_t count = Perft(position, depth - 1);
 
 			totalCount += count;
 
-			std::cout << Utility::GenerateSAN(position, *it, availableMoves) << ": " << std::to_string(count) << std::endl;
+			std::cout << san << ": " << std::to_string(count) << std::endl;
 
-			Position::Unmake(position, *it);
+			Position::Unmake(position, *it, undo);
 		}
 	}
 
@@ -29,20 +29,44 @@
 #include <condition_variable>
 #include <queue>
 #include <mutex>
+#include <cstdlib>
+#include <algorithm>
 
 using namespace TuxedoCat;
 
 extern struct Board currentPosition;
 int maxSearchDepth;
 bool randomMode;
-bool showThinkingOutput;
+std::atomic<bool> showThinkingOutput;
+bool seePruning;
+bool lateMoveReductions;
 
 static bool winboardMode;
 static bool forceMode;
+static bool ponderMode;
+static Move ponderMove;
 static bool computerIsBlack;
+static bool quitRequested;
 static std::queue<std::string> inputQueue;
 
 static std::mutex inputQueueMutex;
+static std::condition_variable inputQueueChanged;
+
+// a move played in the current game, kept with what Unmake needs to take it back
+struct PlayedMove
+{
+	Move Played;
+	UndoInfo Undo;
+};
+
+static std::vector<PlayedMove> moveHistory;
+
+struct CommandHandler
+{
+	const char* Name;
+	void (*Handle)(std::stringstream& arguments);
+	bool StopsSearch;
+};
 
 void Interface::ReadInput()
 {
@@ -50,12 +74,19 @@ void Interface::ReadInput()
 
 	while (true)
 	{
-		std::getline(std::cin, userInput);
+		// running out of input ends the engine like quit would
+
+		if (!std::getline(std::cin, userInput))
+		{
+			userInput = "quit";
+		}
 
 		inputQueueMutex.lock();
 		inputQueue.push(userInput);
 		inputQueueMutex.unlock();
 
+		inputQueueChanged.notify_one();
+
 		if (userInput == "quit")
 		{
 			break;
@@ -63,632 +94,871 @@ void Interface::ReadInput()
 	}
 }
 
+// the search worker calls this when it is done; taking the lock first means the main
+// loop is either already waiting or has yet to look at the search
+static void NotifySearchFinished()
+{
+	inputQueueMutex.lock();
+	inputQueueMutex.unlock();
+
+	inputQueueChanged.notify_one();
+}
+
+// with pondering on, the engine goes on thinking in the opponent's time as if they had
+// already played the reply the search expects
+static void StartPonder()
+{
+	Board ponderPosition = currentPosition;
+	UndoInfo undo;
+
+	ponderMove = Engine::GetPonderMove();
+
+	if (!MoveGenerator::IsLegalMove(currentPosition, ponderMove))
+	{
+		return;
+	}
+
+	Position::Make(ponderPosition, ponderMove, undo);
+	Engine::StartPonder(ponderPosition, currentClock);
+
+	TUXEDOCAT_LOG_DEBUG("pondering on " << Utility::GenerateXBoardNotation(ponderMove));
+}
+
+static bool IsPonderHit(const std::string& input)
+{
+	std::stringstream ss(input);
+	std::string command;
+	std::string moveNotation;
+
+	ss >> command >> moveNotation;
+
+	// too short to parse; usermove reports it once the search is out of the way
+
+	if (moveNotation.length() < 4)
+	{
+		return false;
+	}
+
+	return Engine::IsPondering() && Utility::GetMoveFromXBoardNotation(currentPosition, moveNotation) == ponderMove;
+}
+
+// plays the move a finished search came up with, or just collects the search when the
+// game has moved on without it
+static void PlayMove(Move move)
+{
+	PlayedMove played;
+
+	played.Played = move;
+	Position::Make(currentPosition, move, played.Undo);
+	moveHistory.push_back(played);
+}
+
+static void FinishSearch(bool playMove)
+{
+	std::stringstream output;
+	Move move = Engine::WaitForSearch();
+
+	if (!playMove)
+	{
+		return;
+	}
+
+	if (MoveUtil::IsNullMove(move))
+	{
+		if (Engine::IsGameOver(currentPosition))
+		{
+			output << Engine::GetGameResult(currentPosition);
+			std::cout << output.str() << std::endl;
+
+			Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		}
+		else
+		{
+			Logger::Write(LogLevel::Error, "entered wormhole");
+		}
+
+		return;
+	}
+
+	PlayMove(move);
+
+	output << "move " << Utility::GenerateXBoardNotation(move);
+	std::cout << output.str() << std::endl;
+
+	Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+	output.clear();
+	output.str("");
+
+	if (Engine::IsGameOver(currentPosition))
+	{
+		output << Engine::GetGameResult(currentPosition);
+		std::cout << output.str() << std::endl;
+
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+	}
+	else if (ponderMode)
+	{
+		StartPonder();
+	}
+}
+
 void Interface::OutputFeatures()
 {
 	std::cout << "feature done=0" << std::endl;
-	Utility::WriteLog("engine -> interface: feature done = 0");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature done = 0");
 
 	std::cout << "feature debug=1" << std::endl;
-	Utility::WriteLog("engine -> interface: feature debug=1");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature debug=1");
 
 	std::cout << "feature setboard=1" << std::endl;
-	Utility::WriteLog("engine -> interface: feature setboard=1");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature setboard=1");
 
 	std::cout << "feature usermove=1" << std::endl;
-	Utility::WriteLog("engine -> interface: feature usermove=1");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature usermove=1");
 
 	std::cout << "feature playother=1" << std::endl;
-	Utility::WriteLog("engine -> interface: feature playother=1");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature playother=1");
 
 	std::cout << "feature analyze=0" << std::endl;
-	Utility::WriteLog("engine -> interface: feature analyze=0");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature analyze=0");
 
 	std::cout << "feature sigint=0" << std::endl;
-	Utility::WriteLog("engine -> interface: feature sigint=0");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature sigint=0");
 
 	std::cout << "feature sigterm=0" << std::endl;
-	Utility::WriteLog("engine -> interface: feature sigterm=0");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature sigterm=0");
 
 	std::cout << "feature nps=0" << std::endl;
-	Utility::WriteLog("engine -> interface: feature nps=0");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature nps=0");
 
 	std::cout << "feature san=0" << std::endl;
-	Utility::WriteLog("engine -> interface: feature san=0");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature san=0");
 
 	std::cout << "feature ping=1" << std::endl;
-	Utility::WriteLog("engine -> interface: feature ping=1");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature ping=1");
+
+	std::cout << "feature memory=1" << std::endl;
+	Logger::Write(LogLevel::Info, "engine -> interface: feature memory=1");
+
+	std::cout << "feature smp=1" << std::endl;
+	Logger::Write(LogLevel::Info, "engine -> interface: feature smp=1");
+
+	std::cout << "feature option=\"SEE Pruning -check 1\"" << std::endl;
+	Logger::Write(LogLevel::Info, "engine -> interface: feature option=\"SEE Pruning -check 1\"");
+
+	std::cout << "feature option=\"Late Move Reductions -check 1\"" << std::endl;
+	Logger::Write(LogLevel::Info, "engine -> interface: feature option=\"Late Move Reductions -check 1\"");
 
 	std::cout << "feature myname=\"TuxedoCat\"" << std::endl;
-	Utility::WriteLog("engine -> interface: feature myname=\"TuxedoCat\"");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature myname=\"TuxedoCat\"");
 
 	std::cout << "feature variants=\"normal\"" << std::endl;
-	Utility::WriteLog("engine -> interface: feature variants=\"normal\"");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature variants=\"normal\"");
 
 	std::cout << "feature done=1" << std::endl;
-	Utility::WriteLog("engine -> interface: feature done=1");
+	Logger::Write(LogLevel::Info, "engine -> interface: feature done=1");
 }
 
-void Interface::Run()
+static void HandleQuit(std::stringstream&)
+{
+	quitRequested = true;
+}
+
+static void HandlePost(std::stringstream&)
+{
+	showThinkingOutput = true;
+}
+
+static void HandleNoPost(std::stringstream&)
 {
-	bool inputAvailable = false;
-	winboardMode = false;
-	forceMode = false;
-	computerIsBlack = true;
-	randomMode = false;
 	showThinkingOutput = false;
-	
-	std::string input;
-	std::string command;
-	std::stringstream output;
-	std::stringstream ss;
+}
+
+static void HandleXBoard(std::stringstream&)
+{
+	winboardMode = true;
+
+	std::cout << std::endl;
+}
+
+static void HandleProtoVer(std::stringstream&)
+{
+	Interface::OutputFeatures();
+}
 
+static void HandleNew(std::stringstream&)
+{
 	Engine::InitializeEngine();
+	moveHistory.clear();
+	forceMode = false;
+}
 
-	std::thread inputThread(ReadInput);
+static void HandleRandom(std::stringstream&)
+{
+	randomMode = !randomMode;
+}
 
-	while (true)
+static void HandleSetDepth(std::stringstream& arguments)
+{
+	std::stringstream output;
+	int depth;
+
+	if (arguments >> depth)
 	{
-		inputAvailable = false;
+		maxSearchDepth = depth;
+	}
+	else
+	{
+		output << "Could not parse depth argument " << arguments.str();
+		Logger::Write(LogLevel::Error, output.str());
+		output.clear();
+		output.str("");
+	}
+}
 
-		inputQueueMutex.lock();
-		if (!inputQueue.empty())
-		{
-			inputAvailable = true;
-			ss.str(inputQueue.front());
-			inputQueue.pop();
-		}
-		inputQueueMutex.unlock();
+static void HandleOption(std::stringstream& arguments)
+{
+	std::stringstream output;
+	std::string setting;
+	std::string name;
+	int value = 0;
 
-		if (!inputAvailable)
-		{
-			continue;
-		}
+	// option NAME=VALUE, where the name may contain spaces
 
-		input = ss.str();
-		ss >> command;
+	std::getline(arguments >> std::ws, setting);
 
-		if (command == "quit")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (setting.find('=') != std::string::npos)
+	{
+		name = setting.substr(0, setting.find('='));
+		value = std::atoi(setting.substr(setting.find('=') + 1).c_str());
+	}
 
-			break;
-		}
-		else if (command == "post")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (name == "SEE Pruning")
+	{
+		seePruning = value != 0;
+	}
+	else if (name == "Late Move Reductions")
+	{
+		lateMoveReductions = value != 0;
+	}
+	else
+	{
+		output << "Error (unknown option): " << setting;
+		std::cout << output.str() << std::endl;
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+}
 
-			showThinkingOutput = true;
-		}
-		else if (command == "nopost")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+static void HandleMemory(std::stringstream& arguments)
+{
+	std::stringstream output;
+	uint64_t megabytes;
 
-			showThinkingOutput = false;
-		}
-		else if (command == "xboard")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (arguments >> megabytes && megabytes > 0)
+	{
+		TranspositionTable::Resize(megabytes);
+	}
+	else
+	{
+		output << "Could not parse memory argument " << arguments.str();
+		Logger::Write(LogLevel::Error, output.str());
+		output.clear();
+		output.str("");
+	}
+}
 
-			winboardMode = true;
+static void HandleCores(std::stringstream& arguments)
+{
+	std::stringstream output;
+	int cores;
 
-			std::cout << std::endl;
-		}
-		else if (command == "protover")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (arguments >> cores && cores > 0)
+	{
+		Engine::SetThreadCount(cores);
+	}
+	else
+	{
+		output << "Could not parse cores argument " << arguments.str();
+		Logger::Write(LogLevel::Error, output.str());
+		output.clear();
+		output.str("");
+	}
+}
 
-			OutputFeatures();
-		}
-		else if (command == "new")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+static void HandleTime(std::stringstream& arguments)
+{
+	uint32_t timeValue;
 
-			Engine::InitializeEngine();
-			forceMode = false;
-		}
-		else if (command == "random")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (arguments >> timeValue)
+	{
+		currentClock.remainingTime = timeValue;
+	}
+	else
+	{
+		Logger::Write(LogLevel::Error, "could not parse time value");
+	}
+}
 
-			randomMode = !randomMode;
-		}
-		else if (command == "sd")
-		{
-			int depth;
+static void HandleOpponentTime(std::stringstream&)
+{
+}
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+static void HandleLevel(std::stringstream& arguments)
+{
+	std::stringstream output;
+	uint32_t mpc;
+	std::string remainingTime;
+	uint32_t inc;
+	bool invalidCommand = false;
 
-			if (ss >> depth)
-			{
-				maxSearchDepth = depth;
-			}
-			else
-			{
-				output << "Could not parse depth argument " << input;
-				Utility::WriteLog(output.str());
-				output.clear();
-				output.str("");
-			}
+	if (arguments >> mpc)
+	{
+		currentClock.movesPerControl = mpc;
+	}
+	else
+	{
+		invalidCommand = true;
+	}
+
+	if (arguments >> remainingTime)
+	{
+		if (remainingTime.find(':') == std::string::npos)
+		{
+			currentClock.remainingTime = std::stoi(remainingTime) * 6000;
 		}
-		else if (command == "time")
+		else
 		{
-			uint32_t timeValue;
+			uint32_t minutes = 0;
+			uint32_t seconds = 0;
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+			minutes = std::stoi(remainingTime.substr(0, remainingTime.find(':')));
+			seconds = std::stoi(remainingTime.substr(remainingTime.find(':') + 1));
 
-			if (ss >> timeValue)
-			{
-				currentClock.remainingTime = timeValue;
-			}
-			else
-			{
-				Utility::WriteLog("Error: could not parse time value");
-			}
+			currentClock.remainingTime = ((minutes * 60) + seconds) * 100;
 		}
-		else if (command == "otim")
+	}
+	else
+	{
+		invalidCommand = true;
+	}
+
+	if (arguments >> inc)
+	{
+		if (inc == 0)
 		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+			currentClock.timeIncrement = 0;
+			currentClock.type = TimeControlType::CONVENTIONAL;
 		}
-		else if (command == "level")
+		else
 		{
-			uint32_t mpc;
-			std::string remainingTime;
-			uint32_t inc;
-			bool invalidCommand = false;
+			currentClock.timeIncrement = inc;
+			currentClock.type = TimeControlType::INCREMENTAL;
+		}
+	}
+	else
+	{
+		invalidCommand = true;
+	}
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (invalidCommand)
+	{
+		output << "Error (unknown command)";
+		std::cout << output.str() << std::endl;
+		Logger::Write(LogLevel::Error, output.str());
+		output.clear();
+		output.str("");
 
-			if (ss >> mpc)
-			{
-				currentClock.movesPerControl = mpc;
-			}
-			else
-			{
-				invalidCommand = true;
-			}
+		currentClock.movesPerControl = 40;
+		currentClock.remainingTime = 30000;
+		currentClock.timeIncrement = 0;
+		currentClock.type = TimeControlType::CONVENTIONAL;
+	}
+}
 
-			if (ss >> remainingTime)
-			{
-				if (remainingTime.find(':') == std::string::npos)
-				{
-					currentClock.remainingTime = std::stoi(remainingTime) * 6000;
-				}
-				else
-				{
-					uint32_t minutes = 0;
-					uint32_t seconds = 0;
+static void HandleSetTime(std::stringstream& arguments)
+{
+	std::stringstream output;
+	uint32_t spm;
 
-					minutes = std::stoi(remainingTime.substr(0, remainingTime.find(':')));
-					seconds = std::stoi(remainingTime.substr(remainingTime.find(':') + 1));
+	if (arguments >> spm)
+	{
+		currentClock.movesPerControl = 0;
+		currentClock.remainingTime = spm;
+		currentClock.timeIncrement = 0;
+		currentClock.type = TimeControlType::TIME_PER_MOVE;
+	}
+	else
+	{
+		output << "Error (unknown command)";
+		std::cout << output.str() << std::endl;
+		Logger::Write(LogLevel::Error, output.str());
+		output.clear();
+		output.str("");
 
-					currentClock.remainingTime = ((minutes * 60) + seconds) * 100;
-				}
-			}
-			else
-			{
-				invalidCommand = true;
-			}
+		currentClock.movesPerControl = 40;
+		currentClock.remainingTime = 30000;
+		currentClock.timeIncrement = 0;
+		currentClock.type = TimeControlType::CONVENTIONAL;
+	}
+}
 
-			if (ss >> inc)
-			{
-				if (inc == 0)
-				{
-					currentClock.timeIncrement = 0;
-					currentClock.type = TimeControlType::CONVENTIONAL;
-				}
-				else
-				{
-					currentClock.timeIncrement = inc;
-					currentClock.type = TimeControlType::INCREMENTAL;
-				}
-			}
-			else
-			{
-				invalidCommand = true;
-			}
+static void HandleGo(std::stringstream&)
+{
+	forceMode = false;
 
-			if (invalidCommand)
-			{
-				output << "Error (unknown command)";
-				std::cout << output.str() << std::endl;
-				Utility::WriteLog(output.str());
-				output.clear();
-				output.str("");
+	if (currentPosition.ColorToMove == PieceColor::WHITE)
+	{
+		computerIsBlack = false;
+	}
+	else
+	{
+		computerIsBlack = true;
+	}
 
-				currentClock.movesPerControl = 40;
-				currentClock.remainingTime = 30000;
-				currentClock.timeIncrement = 0;
-				currentClock.type = TimeControlType::CONVENTIONAL;
-			}
-		}
-		else if (command == "st")
-		{
-			uint32_t spm;
+	Engine::StartSearch(currentPosition, currentClock);
+}
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+static void HandlePlayOther(std::stringstream&)
+{
+	forceMode = false;
 
-			if (ss >> spm)
-			{
-				currentClock.movesPerControl = 0;
-				currentClock.remainingTime = spm;
-				currentClock.timeIncrement = 0;
-				currentClock.type = TimeControlType::TIME_PER_MOVE;
-			}
-			else
-			{
-				output << "Error (unknown command)";
-				std::cout << output.str() << std::endl;
-				Utility::WriteLog(output.str());
-				output.clear();
-				output.str("");
+	if (currentPosition.ColorToMove == PieceColor::WHITE)
+	{
+		computerIsBlack = true;
+	}
+	else
+	{
+		computerIsBlack = false;
+	}
+}
 
-				currentClock.movesPerControl = 40;
-				currentClock.remainingTime = 30000;
-				currentClock.timeIncrement = 0;
-				currentClock.type = TimeControlType::CONVENTIONAL;
-			}
-		}
-		else if (command == "go")
-		{
-			forceMode = false;
+static void HandlePing(std::stringstream& arguments)
+{
+	std::stringstream output;
+	int value;
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (arguments >> value)
+	{
+		output << "pong " << value;
+		std::cout << output.str() << std::endl;
 
-			if (currentPosition.ColorToMove == PieceColor::WHITE)
-			{
-				computerIsBlack = false;
-			}
-			else
-			{
-				computerIsBlack = true;
-			}
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+}
 
-			std::string move = Engine::GetMove(currentPosition, currentClock);
+static void HandlePerft(std::stringstream& arguments)
+{
+	std::stringstream output;
+	int depth;
 
-			if (move == "")
-			{
-				if (Engine::IsGameOver(currentPosition))
-				{
-					output << Engine::GetGameResult(currentPosition);
-					std::cout << output.str() << std::endl;
+	if (arguments >> depth)
+	{
+		output << "Perft (" << depth << "): " << Engine::Perft(currentPosition, depth);
+		std::cout << output.str() << std::endl;
 
-					Utility::WriteLog("engine -> interface: " + output.str());
-					output.clear();
-					output.str("");
-				}
-			}
-			else
-			{
-				if (Engine::IsGameOver(currentPosition))
-				{
-					output << Engine::GetGameResult(currentPosition);
-					std::cout << output.str() << std::endl;
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+	else
+	{
+		output << "Error: depth parameter required";
+		std::cout << output.str() << std::endl;
 
-					Utility::WriteLog("engine -> interface: " + output.str());
-					output.clear();
-					output.str("");
-				}
-				else
-				{
-					output << "move " << move;
-					std::cout << output.str() << std::endl;
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+}
 
-					Utility::WriteLog("engine -> interface: " + output.str());
-					output.clear();
-					output.str("");
-				}
-			}
-		}
-		else if (command == "playother")
+static void HandleHashedPerft(std::stringstream& arguments)
+{
+	std::stringstream output;
+	int depth;
+	uint64_t megabytes = Engine::DEFAULT_PERFT_HASH_MB;
+
+	// hperft DEPTH [HASH MB]
+
+	if (arguments >> depth)
+	{
+		arguments >> megabytes;
+
+		output << "Perft (" << depth << "): " << Engine::HashedPerft(currentPosition, depth, megabytes);
+		std::cout << output.str() << std::endl;
+
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+	else
+	{
+		output << "Error: depth parameter required";
+		std::cout << output.str() << std::endl;
+
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+}
+
+static void HandleParallelPerft(std::stringstream& arguments)
+{
+	std::stringstream output;
+	int depth;
+	int splitDepth = ParallelPerft::DEFAULT_SPLIT_DEPTH;
+	int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+	PerftResult result;
+
+	// pperft DEPTH [SPLIT DEPTH [THREADS]]
+
+	if (arguments >> depth)
+	{
+		arguments >> splitDepth >> threadCount;
+
+		ParallelPerft::Run(currentPosition, depth, splitDepth, threadCount, result);
+
+		for (size_t i = 0; i < result.ThreadNodes.size(); i++)
 		{
-			forceMode = false;
+			output << "Thread " << i << ": " << result.ThreadNodes[i] << std::endl;
+		}
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+		output << "Time: " << result.Milliseconds << " ms, NPS: "
+			<< result.Nodes * 1000 / std::max(result.Milliseconds, 1LL) << std::endl;
+		output << "Perft (" << depth << "): " << result.Nodes;
+		std::cout << output.str() << std::endl;
 
-			if (currentPosition.ColorToMove == PieceColor::WHITE)
-			{
-				computerIsBlack = true;
-			}
-			else
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+	else
+	{
+		output << "Error: depth parameter required";
+		std::cout << output.str() << std::endl;
+
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+}
+
+static void HandleDivide(std::stringstream& arguments)
+{
+	std::stringstream output;
+	int depth;
+
+	if (arguments >> depth)
+	{
+		Engine::Divide(currentPosition, depth);
+	}
+	else
+	{
+		output << "Error: depth parameter required";
+		std::cout << output.str() << std::endl;
+
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		output.clear();
+		output.str("");
+	}
+}
+
+static void HandleSetBoard(std::stringstream& arguments)
+{
+	std::stringstream output;
+	std::string fenPart;
+	std::stringstream fen;
+	int fenPartCount = 0;
+
+	while (fenPartCount < 6)
+	{
+		if (arguments >> fenPart)
+		{
+			fen << fenPart;
+
+			if (fenPartCount < 5)
 			{
-				computerIsBlack = false;
+				fen << " ";
 			}
+
+			fenPartCount++;
+		}
+		else
+		{
+			break;
 		}
-		else if (command == "ping")
+	}
+
+	if (fenPartCount < 6)
+	{
+		if (winboardMode)
 		{
-			int value;
+			Logger::Write(LogLevel::Error, "Invalid FEN received");
+		}
+		else
+		{
+			output << "Error: Invalid FEN received";
+			std::cout << output.str() << std::endl;
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
+			Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
 			output.clear();
 			output.str("");
+		}
+	}
+	else
+	{
+		Position::SetPosition(currentPosition, fen.str());
+		moveHistory.clear();
+	}
+}
 
-			if (ss >> value)
-			{
-				output << "pong " << value;
-				std::cout << output.str() << std::endl;
+static void HandleUserMove(std::stringstream& arguments)
+{
+	std::stringstream output;
+	std::string moveNotation;
+	TuxedoCat::Move move;
 
-				Utility::WriteLog("engine -> interface: " + output.str());
-				output.clear();
-				output.str("");
-			}
-		}
-		else if (command == "perft")
+	if (arguments >> moveNotation)
+	{
+		if (moveNotation.length() < 4)
 		{
-			int depth;
+			output << "Error (ambiguous move): " << moveNotation;
+			std::cout << output.str() << std::endl;
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
+			Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
 			output.clear();
 			output.str("");
+		}
+		else
+		{
+			move = Utility::GetMoveFromXBoardNotation(currentPosition, moveNotation);
 
-			if (ss >> depth)
+			if (MoveUtil::IsNullMove(move))
 			{
-				output << "Perft (" << depth << "): " << Engine::Perft(currentPosition, depth);
+				output << "Illegal move: " << moveNotation;
 				std::cout << output.str() << std::endl;
 
-				Utility::WriteLog("engine -> interface: " + output.str());
+				Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
 				output.clear();
 				output.str("");
 			}
 			else
 			{
-				output << "Error: depth parameter required";
-				std::cout << output.str() << std::endl;
+				PlayMove(move);
 
-				Utility::WriteLog("engine -> interface: " + output.str());
-				output.clear();
-				output.str("");
+				if (Engine::IsPondering())
+				{
+					Engine::PonderHit(currentPosition, currentClock);
+				}
+				else if (!forceMode)
+				{
+					Engine::StartSearch(currentPosition, currentClock);
+				}
 			}
 		}
-		else if (command == "divide")
-		{
-			int depth;
+	}
+}
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+// ? ends the search early with the best move so far; a ponder search has no move to give up
+static void HandleMoveNow(std::stringstream&)
+{
+	if (Engine::IsSearching() && !Engine::IsPondering())
+	{
+		Engine::StopSearch();
+	}
+}
 
-			if (ss >> depth)
-			{
-				Engine::Divide(currentPosition, depth);
-			}
-			else
-			{
-				output << "Error: depth parameter required";
-				std::cout << output.str() << std::endl;
+static void HandleHard(std::stringstream&)
+{
+	ponderMode = true;
+}
 
-				Utility::WriteLog("engine -> interface: " + output.str());
-				output.clear();
-				output.str("");
-			}
-		}
-		else if (command == "setboard")
-		{
-			std::string fenPart;
-			std::stringstream fen;
-			int fenPartCount = 0;
+static void HandleEasy(std::stringstream&)
+{
+	ponderMode = false;
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+	if (Engine::IsPondering())
+	{
+		Engine::StopSearch();
+		FinishSearch(false);
+	}
+}
 
-			while (fenPartCount < 6)
-			{
-				if (ss >> fenPart)
-				{
-					fen << fenPart;
+// takes back the last moves of the game; anything set up with setboard can't be undone
+static void TakeBackMoves(int count)
+{
+	std::stringstream output;
 
-					if (fenPartCount < 5)
-					{
-						fen << " ";
-					}
+	if (static_cast<int>(moveHistory.size()) < count)
+	{
+		output << "Error (no move to take back)";
+		std::cout << output.str() << std::endl;
 
-					fenPartCount++;
-				}
-				else
-				{
-					break;
-				}
-			}
+		Logger::Write(LogLevel::Info, "engine -> interface: " + output.str());
+		return;
+	}
 
-			if (fenPartCount < 6)
-			{
-				if (winboardMode)
-				{
-					Utility::WriteLog("Error: Invalid FEN received");
-				}
-				else
-				{
-					output << "Error: Invalid FEN received";
-					std::cout << output.str() << std::endl;
+	for (int i = 0; i < count; i++)
+	{
+		Position::Unmake(currentPosition, moveHistory.back().Played, moveHistory.back().Undo);
+		moveHistory.pop_back();
+	}
+}
 
-					Utility::WriteLog("engine -> interface: " + output.str());
-					output.clear();
-					output.str("");
-				}
-			}
-			else
-			{
-				Position::SetPosition(currentPosition, fen.str());
-			}
-		}
-		else if (command == "usermove")
-		{
-			std::string moveNotation;
-			TuxedoCat::Move move;
+static void HandleUndo(std::stringstream&)
+{
+	TakeBackMoves(1);
+}
 
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+// takes back the user's last move and the engine's reply, leaving the user to move again
+static void HandleRemove(std::stringstream&)
+{
+	TakeBackMoves(2);
+}
 
-			if (ss >> moveNotation)
-			{
-				if (moveNotation.length() < 4)
-				{
-					output << "Error (ambiguous move): " << moveNotation;
-					std::cout << output.str() << std::endl;
+static void HandleForce(std::stringstream&)
+{
+	forceMode = true;
+}
 
-					Utility::WriteLog("engine -> interface: " + output.str());
-					output.clear();
-					output.str("");
-				}
-				else
-				{
-					move = Utility::GetMoveFromXBoardNotation(currentPosition, moveNotation);
-
-					if (move.TargetLocation == 0)
-					{
-						output << "Illegal move: " << moveNotation;
-						std::cout << output.str() << std::endl;
-
-						Utility::WriteLog("engine -> interface: " + output.str());
-						output.clear();
-						output.str("");
-					}
-					else
-					{
-						Position::Make(currentPosition, move);
-
-						if (!forceMode)
-						{
-							std::string move = Engine::GetMove(currentPosition, currentClock);
-
-							if (move == "")
-							{
-								if (Engine::IsGameOver(currentPosition))
-								{
-									output << Engine::GetGameResult(currentPosition);
-									std::cout << output.str() << std::endl;
-
-									Utility::WriteLog("engine -> interface: " + output.str());
-									output.clear();
-									output.str("");
-								}
-								else
-								{
-									Utility::WriteLog("entered wormhole");
-								}
-							}
-							else
-							{
-								if (Engine::IsGameOver(currentPosition))
-								{
-									output << "move " << move;
-									std::cout << output.str() << std::endl;
-
-									Utility::WriteLog("engine -> interface: " + output.str());
-									output.clear();
-									output.str("");
-
-									output << Engine::GetGameResult(currentPosition);
-									std::cout << output.str() << std::endl;
-
-									Utility::WriteLog("engine -> interface: " + output.str());
-									output.clear();
-									output.str("");
-								}
-								else
-								{
-									output << "move " << move;
-									std::cout << output.str() << std::endl;
-
-									Utility::WriteLog("engine -> interface: " + output.str());
-									output.clear();
-									output.str("");
-								}
-							}
-						}
-					}
-				}
-			}
-		}
-		else if (command == "force")
-		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+static void HandleResult(std::stringstream&)
+{
+	forceMode = true;
+	Engine::InitializeEngine();
+	moveHistory.clear();
+}
 
-			forceMode = true;
+static void HandleTest(std::stringstream&)
+{
+	Test::RunTests();
+}
+
+// commands that change the game, or state the search reads, abandon a running search
+// first; everything else, unknown commands included, runs alongside it
+static const CommandHandler commandHandlers[] =
+{
+	{ "quit", HandleQuit, true },
+	{ "post", HandlePost, false },
+	{ "nopost", HandleNoPost, false },
+	{ "xboard", HandleXBoard, false },
+	{ "protover", HandleProtoVer, false },
+	{ "new", HandleNew, true },
+	{ "random", HandleRandom, true },
+	{ "sd", HandleSetDepth, true },
+	{ "option", HandleOption, true },
+	{ "memory", HandleMemory, true },
+	{ "cores", HandleCores, true },
+	{ "time", HandleTime, false },
+	{ "otim", HandleOpponentTime, false },
+	{ "level", HandleLevel, false },
+	{ "st", HandleSetTime, false },
+	{ "go", HandleGo, true },
+	{ "playother", HandlePlayOther, true },
+	{ "ping", HandlePing, false },
+	{ "perft", HandlePerft, true },
+	{ "hperft", HandleHashedPerft, true },
+	{ "pperft", HandleParallelPerft, true },
+	{ "divide", HandleDivide, true },
+	{ "setboard", HandleSetBoard, true },
+	{ "usermove", HandleUserMove, true },
+	{ "?", HandleMoveNow, false },
+	{ "hard", HandleHard, false },
+	{ "easy", HandleEasy, false },
+	{ "force", HandleForce, true },
+	{ "result", HandleResult, true },
+	{ "test", HandleTest, true },
+	{ "undo", HandleUndo, true },
+	{ "remove", HandleRemove, true }
+};
+
+static const CommandHandler* FindCommandHandler(const std::string& command)
+{
+	for (const CommandHandler& handler : commandHandlers)
+	{
+		if (command == handler.Name)
+		{
+			return &handler;
 		}
-		else if (command == "result")
+	}
+
+	return nullptr;
+}
+
+void Interface::Run()
+{
+	winboardMode = false;
+	forceMode = false;
+	ponderMode = false;
+	quitRequested = false;
+	computerIsBlack = true;
+	randomMode = false;
+	showThinkingOutput = false;
+	seePruning = true;
+	lateMoveReductions = true;
+	moveHistory.clear();
+	
+	std::string input;
+	std::string command;
+	std::stringstream ss;
+	const CommandHandler* handler;
+
+	Logger::Start("log.txt");
+	Attacks::InitializeAttacks();
+	Zobrist::InitializeKeys();
+	TranspositionTable::Resize(TranspositionTable::DEFAULT_SIZE_MB);
+	Engine::SetThreadCount(1);
+	Engine::SetSearchFinishedHandler(NotifySearchFinished);
+	Engine::InitializeEngine();
+
+	std::thread inputThread(ReadInput);
+
+	while (!quitRequested)
+	{
+		// sleep until there is a command to handle or a finished search to play out
+
+		std::unique_lock<std::mutex> lock(inputQueueMutex);
+		inputQueueChanged.wait(lock, []
 		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+			return !inputQueue.empty() || (Engine::IsSearching() && Engine::IsSearchFinished());
+		});
 
-			forceMode = true;
-			Engine::InitializeEngine();
-		}
-		else if (command == "test")
+		if (Engine::IsSearching() && Engine::IsSearchFinished())
 		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+			lock.unlock();
+			FinishSearch(true);
+			continue;
+		}
+
+		input = inputQueue.front();
+		inputQueue.pop();
+		lock.unlock();
+
+		ss.str(input);
+		ss >> command;
+
+		Logger::Write(LogLevel::Info, "interface -> engine: " + input);
+
+		handler = FindCommandHandler(command);
 
-			Test::RunTests();
+		// a ponder search is kept by the move it predicted
+
+		if (Engine::IsSearching() && handler != nullptr && handler->StopsSearch
+			&& !(command == "usermove" && IsPonderHit(input)))
+		{
+			Engine::StopSearch();
+			FinishSearch(false);
 		}
-		else
+
+		if (handler != nullptr)
 		{
-			output << "interface -> engine: " << input;
-			Utility::WriteLog(output.str());
-			output.clear();
-			output.str("");
+			handler->Handle(ss);
 		}
 
 		ss.clear();
 		ss.str("");
-		output.clear();
-		output.str("");
-		input = "";
 		command = "";
 	}
 
@@ -697,5 +967,6 @@ void Interface::Run()
 		inputThread.join();
 	}
 
-	Utility::WriteLog("Engine closing...");
+	Logger::Write(LogLevel::Info, "Engine closing...");
+	Logger::Stop();
 }
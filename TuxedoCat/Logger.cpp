@@ -0,0 +1,241 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 Nathan McCrina
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "TuxedoCat.h"
+#include <fstream>
+#include <ctime>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef _WIN32
+#include <time.h>
+#endif
+
+using namespace TuxedoCat;
+
+// one slot of the ring buffer. a slot whose sequence equals the write position is free
+// for the producer that claims that position; one past it holds a finished message
+struct LogEntry
+{
+	std::atomic<uint64_t> Sequence;
+	LogLevel Level;
+	std::chrono::system_clock::time_point Time;
+	std::string Message;
+};
+
+static LogEntry queue[Logger::QUEUE_SIZE];
+static std::atomic<uint64_t> writePosition(0);
+static uint64_t readPosition;
+static std::atomic<bool> running(false);
+static std::atomic<int> activeWriters(0);
+static bool writerStopping;
+static std::thread logWriter;
+static std::ofstream logFile;
+static std::mutex wakeMutex;
+static std::condition_variable wake;
+
+static const char* GetLevelName(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Debug:
+		return "debug";
+	case LogLevel::Error:
+		return "error";
+	default:
+		return "info";
+	}
+}
+
+// only the writer thread reads, so taking a message needs no compare and swap
+static bool TakeEntry(LogLevel& level, std::chrono::system_clock::time_point& time, std::string& message)
+{
+	LogEntry& entry = queue[readPosition % Logger::QUEUE_SIZE];
+
+	if (entry.Sequence.load(std::memory_order_acquire) != readPosition + 1)
+	{
+		return false;
+	}
+
+	level = entry.Level;
+	time = entry.Time;
+	message = std::move(entry.Message);
+
+	entry.Sequence.store(readPosition + Logger::QUEUE_SIZE, std::memory_order_release);
+	readPosition++;
+
+	return true;
+}
+
+// localtime is only ever called from here, on the one writer thread
+static void WriteEntry(LogLevel level, std::chrono::system_clock::time_point time, std::string& message)
+{
+	std::time_t entryTime = std::chrono::system_clock::to_time_t(time);
+
+    #ifdef _WIN32
+	std::tm tm_struct;
+
+	localtime_s(&tm_struct, &entryTime);
+	logFile << std::put_time(&tm_struct, "%c");
+    #else
+	logFile << std::put_time(localtime(&entryTime), "%c");
+    #endif
+
+	logFile << " [" << GetLevelName(level) << "] " << message << '\n';
+}
+
+// drains whatever has queued up, then flushes once per batch
+static void RunLogWriter()
+{
+	LogLevel level;
+	std::chrono::system_clock::time_point time;
+	std::string message;
+	bool stopping = false;
+
+	while (!stopping)
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			stopping = writerStopping;
+		}
+
+		if (TakeEntry(level, time, message))
+		{
+			do
+			{
+				WriteEntry(level, time, message);
+			} while (TakeEntry(level, time, message));
+
+			logFile.flush();
+		}
+
+		if (!stopping)
+		{
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wake.wait_for(lock, std::chrono::milliseconds(Logger::FLUSH_INTERVAL_MS), [] { return writerStopping; });
+		}
+	}
+}
+
+void Logger::Start(std::string fileName)
+{
+	if (running.load())
+	{
+		return;
+	}
+
+	for (uint64_t i = 0; i < static_cast<uint64_t>(QUEUE_SIZE); i++)
+	{
+		queue[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	writePosition.store(0);
+	readPosition = 0;
+
+	logFile.open(fileName, std::ios_base::app);
+	writerStopping = false;
+	running.store(true);
+	logWriter = std::thread(RunLogWriter);
+}
+
+// everything written before the stop still reaches the file. writes already past the
+// running check are let finish before the writer is told to do its last drain
+void Logger::Stop()
+{
+	if (!running.load())
+	{
+		return;
+	}
+
+	running.store(false);
+
+	while (activeWriters.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		writerStopping = true;
+	}
+
+	wake.notify_one();
+	logWriter.join();
+	logFile.close();
+}
+
+// producers claim a position with a compare and swap and never wait on a lock; when the
+// writer has fallen a whole queue behind they yield until it catches up rather than
+// dropping messages. messages before Start or after Stop are discarded
+void Logger::Write(LogLevel level, std::string message)
+{
+	uint64_t position;
+	int64_t difference;
+
+	// registering before looking at running means Stop either sees this write in flight
+	// or this write sees the stop
+
+	activeWriters.fetch_add(1);
+
+	if (!running.load())
+	{
+		activeWriters.fetch_sub(1);
+		return;
+	}
+
+	position = writePosition.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		LogEntry& entry = queue[position % QUEUE_SIZE];
+
+		difference = static_cast<int64_t>(entry.Sequence.load(std::memory_order_acquire)) - static_cast<int64_t>(position);
+
+		if (difference == 0)
+		{
+			if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				entry.Level = level;
+				entry.Time = std::chrono::system_clock::now();
+				entry.Message = std::move(message);
+				entry.Sequence.store(position + 1, std::memory_order_release);
+				activeWriters.fetch_sub(1);
+
+				return;
+			}
+		}
+		else if (difference < 0)
+		{
+			std::this_thread::yield();
+			position = writePosition.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			position = writePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
@@ -26,39 +26,25 @@
 
 using namespace TuxedoCat;
 
-void MoveUtil::InitializeMove(Move& move, uint64_t tgt, uint64_t src, uint64_t cep, PieceColor mc, PieceRank mp,
-	PieceRank cp, PieceRank pr, int chm, int cs)
-{
-	move.TargetLocation = tgt;
-	move.SourceLocation = src;
-	move.CurrentEnPassant = cep;
-	move.MoveColor = mc;
-	move.MovingPiece = mp;
-	move.CapturedPiece = cp;
-	move.PromotedRank = pr;
-	move.CurrentHalfMoves = chm;
-	move.CastlingStatus = cs;
-}
-
 bool MoveUtil::compareMoves(Move& m1, Move& m2)
 {
 	bool result = false;
 
-	if (m1.CapturedPiece != PieceRank::NONE)
+	if (GetCapturedPiece(m1) != PieceRank::NONE)
 	{
-		if (m2.CapturedPiece == PieceRank::NONE)
+		if (GetCapturedPiece(m2) == PieceRank::NONE)
 		{
 			result = true;
 		}
 		else
 		{
-			if (Utility::ComparePieces(m2.CapturedPiece, m1.CapturedPiece))
+			if (Utility::ComparePieces(GetCapturedPiece(m2), GetCapturedPiece(m1)))
 			{
 				result = true;
 			}
-			else if (!Utility::ComparePieces(m1.CapturedPiece, m2.CapturedPiece))
+			else if (!Utility::ComparePieces(GetCapturedPiece(m1), GetCapturedPiece(m2)))
 			{
-				if (Utility::ComparePieces(m1.MovingPiece, m2.MovingPiece))
+				if (Utility::ComparePieces(GetMovingPiece(m1), GetMovingPiece(m2)))
 				{
 					result = true;
 				}
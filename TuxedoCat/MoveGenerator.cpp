@@ -28,88 +28,6 @@ using namespace TuxedoCat;
 using namespace TuxedoCat::Position;
 using namespace TuxedoCat::Utility;
 
-static std::vector<Move> moveList;
-
-static uint64_t FileMask[64] = {
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL,
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL,
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL,
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL,
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL,
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL,
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL,
-	0x0101010101010101ULL, 0x0202020202020202ULL, 0x0404040404040404ULL, 0x0808080808080808ULL,
-	0x1010101010101010ULL, 0x2020202020202020ULL, 0x4040404040404040ULL, 0x8080808080808080ULL
-
-};
-
-static uint64_t RankMask[64] = {
-	0x00000000000000FFULL, 0x00000000000000FFULL, 0x00000000000000FFULL, 0x00000000000000FFULL,
-	0x00000000000000FFULL, 0x00000000000000FFULL, 0x00000000000000FFULL, 0x00000000000000FFULL,
-	0x000000000000FF00ULL, 0x000000000000FF00ULL, 0x000000000000FF00ULL, 0x000000000000FF00ULL,
-	0x000000000000FF00ULL, 0x000000000000FF00ULL, 0x000000000000FF00ULL, 0x000000000000FF00ULL,
-	0x0000000000FF0000ULL, 0x0000000000FF0000ULL, 0x0000000000FF0000ULL, 0x0000000000FF0000ULL,
-	0x0000000000FF0000ULL, 0x0000000000FF0000ULL, 0x0000000000FF0000ULL, 0x0000000000FF0000ULL,
-	0x00000000FF000000ULL, 0x00000000FF000000ULL, 0x00000000FF000000ULL, 0x00000000FF000000ULL,
-	0x00000000FF000000ULL, 0x00000000FF000000ULL, 0x00000000FF000000ULL, 0x00000000FF000000ULL,
-	0x000000FF00000000ULL, 0x000000FF00000000ULL, 0x000000FF00000000ULL, 0x000000FF00000000ULL,
-	0x000000FF00000000ULL, 0x000000FF00000000ULL, 0x000000FF00000000ULL, 0x000000FF00000000ULL,
-	0x0000FF0000000000ULL, 0x0000FF0000000000ULL, 0x0000FF0000000000ULL, 0x0000FF0000000000ULL,
-	0x0000FF0000000000ULL, 0x0000FF0000000000ULL, 0x0000FF0000000000ULL, 0x0000FF0000000000ULL,
-	0x00FF000000000000ULL, 0x00FF000000000000ULL, 0x00FF000000000000ULL, 0x00FF000000000000ULL,
-	0x00FF000000000000ULL, 0x00FF000000000000ULL, 0x00FF000000000000ULL, 0x00FF000000000000ULL,
-	0xFF00000000000000ULL, 0xFF00000000000000ULL, 0xFF00000000000000ULL, 0xFF00000000000000ULL,
-	0xFF00000000000000ULL, 0xFF00000000000000ULL, 0xFF00000000000000ULL, 0xFF00000000000000ULL
-
-};
-
-static uint64_t SWNEMask[64] = {
-	0x8040201008040201ULL, 0x0080402010080402ULL, 0x0000804020100804ULL, 0x0000008040201008ULL,
-	0x0000000080402010ULL, 0x0000000000804020ULL, 0x0000000000008040ULL, 0x0000000000000080ULL,
-	0x4020100804020100ULL, 0x8040201008040201ULL, 0x0080402010080402ULL, 0x0000804020100804ULL,
-	0x0000008040201008ULL, 0x0000000080402010ULL, 0x0000000000804020ULL, 0x0000000000008040ULL,
-	0x2010080402010000ULL, 0x4020100804020100ULL, 0x8040201008040201ULL, 0x0080402010080402ULL,
-	0x0000804020100804ULL, 0x0000008040201008ULL, 0x0000000080402010ULL, 0x0000000000804020ULL,
-	0x1008040201000000ULL, 0x2010080402010000ULL, 0x4020100804020100ULL, 0x8040201008040201ULL,
-	0x0080402010080402ULL, 0x0000804020100804ULL, 0x0000008040201008ULL, 0x0000000080402010ULL,
-	0x0804020100000000ULL, 0x1008040201000000ULL, 0x2010080402010000ULL, 0x4020100804020100ULL,
-	0x8040201008040201ULL, 0x0080402010080402ULL, 0x0000804020100804ULL, 0x0000008040201008ULL,
-	0x0402010000000000ULL, 0x0804020100000000ULL, 0x1008040201000000ULL, 0x2010080402010000ULL,
-	0x4020100804020100ULL, 0x8040201008040201ULL, 0x0080402010080402ULL, 0x0000804020100804ULL,
-	0x0201000000000000ULL, 0x0402010000000000ULL, 0x0804020100000000ULL, 0x1008040201000000ULL,
-	0x2010080402010000ULL, 0x4020100804020100ULL, 0x8040201008040201ULL, 0x0080402010080402ULL,
-	0x0100000000000000ULL, 0x0201000000000000ULL, 0x0402010000000000ULL, 0x0804020100000000ULL,
-	0x1008040201000000ULL, 0x2010080402010000ULL, 0x4020100804020100ULL, 0x8040201008040201ULL
-
-};
-
-static uint64_t NWSEMask[64] = {
-	0x0000000000000001ULL, 0x0000000000000102ULL, 0x0000000000010204ULL, 0x0000000001020408ULL,
-	0x0000000102040810ULL, 0x0000010204081020ULL, 0x0001020408102040ULL, 0x0102040810204080ULL,
-	0x0000000000000102ULL, 0x0000000000010204ULL, 0x0000000001020408ULL, 0x0000000102040810ULL,
-	0x0000010204081020ULL, 0x0001020408102040ULL, 0x0102040810204080ULL, 0x0204081020408000ULL,
-	0x0000000000010204ULL, 0x0000000001020408ULL, 0x0000000102040810ULL, 0x0000010204081020ULL,
-	0x0001020408102040ULL, 0x0102040810204080ULL, 0x0204081020408000ULL, 0x0408102040800000ULL,
-	0x0000000001020408ULL, 0x0000000102040810ULL, 0x0000010204081020ULL, 0x0001020408102040ULL,
-	0x0102040810204080ULL, 0x0204081020408000ULL, 0x0408102040800000ULL, 0x0810204080000000ULL,
-	0x0000000102040810ULL, 0x0000010204081020ULL, 0x0001020408102040ULL, 0x0102040810204080ULL,
-	0x0204081020408000ULL, 0x0408102040800000ULL, 0x0810204080000000ULL, 0x1020408000000000ULL,
-	0x0000010204081020ULL, 0x0001020408102040ULL, 0x0102040810204080ULL, 0x0204081020408000ULL,
-	0x0408102040800000ULL, 0x0810204080000000ULL, 0x1020408000000000ULL, 0x2040800000000000ULL,
-	0x0001020408102040ULL, 0x0102040810204080ULL, 0x0204081020408000ULL, 0x0408102040800000ULL,
-	0x0810204080000000ULL, 0x1020408000000000ULL, 0x2040800000000000ULL, 0x4080000000000000ULL,
-	0x0102040810204080ULL, 0x0204081020408000ULL, 0x0408102040800000ULL, 0x0810204080000000ULL,
-	0x1020408000000000ULL, 0x2040800000000000ULL, 0x4080000000000000ULL, 0x8000000000000000ULL
-
-};
-
 uint64_t KnightAttacks[64] = {
 	0x0000000000020400ULL, 0x0000000000050800ULL, 0x00000000000A1100ULL, 0x0000000000142200ULL,
 	0x0000000000284400ULL, 0x0000000000508800ULL, 0x0000000000A01000ULL, 0x0000000000402000ULL,
@@ -310,20 +228,44 @@ uint64_t RayAttacksSW[64] = {
 
 };
 
-std::vector<Move> MoveGenerator::GenerateMoves(Board& position, PieceRank rankFilter)
+// squares a non-pawn move of the given type may land on
+static uint64_t GetTypeTargets(Board& position, GenerationType type)
 {
-	uint64_t pieces = position.ColorToMove == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
-	uint64_t currentPiece;
-	PieceRank rank;
-	bool inCheck = false;
+	uint64_t targets = 0xFFFFFFFFFFFFFFFFULL;
 
-	moveList.clear();
+	if (type == GenerationType::CAPTURES)
+	{
+		targets = position.ColorToMove == PieceColor::WHITE ? position.BlackPieces : position.WhitePieces;
+	}
+	else if (type == GenerationType::QUIETS)
+	{
+		targets = ~(position.WhitePieces | position.BlackPieces);
+	}
 
-	if (IsSquareAttacked(position.ColorToMove ==
-		PieceColor::WHITE ? position.WhiteKing : position.BlackKing, position))
+	return targets;
+}
+
+static void GenerateMovesOfType(Board& position, uint64_t pieces, GenerationType type, MoveList& moveList)
+{
+	CheckInfo checkInfo;
+
+	moveList.Count = 0;
+
+	MoveGenerator::GetCheckInfo(position, checkInfo);
+
+	if (checkInfo.Checkers != 0x0000000000000000ULL)
 	{
-		inCheck = true;
+		MoveGenerator::GenerateEvasions(position, pieces, type, checkInfo, moveList);
 	}
+	else
+	{
+		MoveGenerator::GeneratePieceMoves(position, pieces, 0xFFFFFFFFFFFFFFFFULL, type, checkInfo, moveList);
+	}
+}
+
+void MoveGenerator::GenerateMoves(Board& position, MoveList& moveList, PieceRank rankFilter)
+{
+	uint64_t pieces = position.ColorToMove == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
 
 	if (rankFilter == PieceRank::PAWN)
 	{
@@ -350,325 +292,165 @@ std::vector<Move> MoveGenerator::GenerateMoves(Board& position, PieceRank rankFi
 		pieces = pieces & (position.WhiteKing | position.BlackKing);
 	}
 
-	while (pieces != 0x0000000000000000ULL)
-	{
-		currentPiece = 0x0000000000000001ULL << GetLSB(pieces);
-		rank = GetRankAt(position, currentPiece);
-
-		if (rank == PieceRank::KNIGHT)
-		{
-			if (!IsPiecePinnedFile(position, currentPiece)
-				&& !IsPiecePinnedRank(position, currentPiece)
-				&& !IsPiecePinnedNWSE(position, currentPiece)
-				&& !IsPiecePinnedSWNE(position, currentPiece))
-			{
-				GenerateKnightMovesAt(currentPiece, position, inCheck);
-			}
-		}
-		else if (rank == PieceRank::BISHOP)
-		{
-			if (!IsPiecePinnedFile(position, currentPiece)
-				&& !IsPiecePinnedRank(position, currentPiece))
-			{
-				if (!IsPiecePinnedNWSE(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x02, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x20, inCheck);
-				}
+	GenerateMovesOfType(position, pieces, GenerationType::ALL, moveList);
+}
 
-				if (!IsPiecePinnedSWNE(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x08, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x80, inCheck);
-				}
-			}
-		}
-		else if (rank == PieceRank::ROOK)
-		{
-			if (!IsPiecePinnedNWSE(position, currentPiece)
-				&& !IsPiecePinnedSWNE(position, currentPiece))
-			{
-				if (!IsPiecePinnedRank(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x01, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x10, inCheck);
-				}
+void MoveGenerator::GenerateCaptures(Board& position, MoveList& moveList)
+{
+	uint64_t pieces = position.ColorToMove == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
 
-				if (!IsPiecePinnedFile(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x04, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x40, inCheck);
-				}
-			}
-		}
-		else if (rank == PieceRank::QUEEN)
-		{
-			if (!IsPiecePinnedNWSE(position, currentPiece)
-				&& !IsPiecePinnedSWNE(position, currentPiece))
-			{
-				if (!IsPiecePinnedRank(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x01, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x10, inCheck);
-				}
+	GenerateMovesOfType(position, pieces, GenerationType::CAPTURES, moveList);
+}
 
-				if (!IsPiecePinnedFile(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x04, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x40, inCheck);
-				}
-			}
+void MoveGenerator::GenerateQuiets(Board& position, MoveList& moveList)
+{
+	uint64_t pieces = position.ColorToMove == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
 
-			if (!IsPiecePinnedFile(position, currentPiece)
-				&& !IsPiecePinnedRank(position, currentPiece))
-			{
-				if (!IsPiecePinnedNWSE(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x02, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x20, inCheck);
-				}
+	GenerateMovesOfType(position, pieces, GenerationType::QUIETS, moveList);
+}
 
-				if (!IsPiecePinnedSWNE(position, currentPiece))
-				{
-					GenerateSlidingMovesAt(position, currentPiece, 0x08, inCheck);
-					GenerateSlidingMovesAt(position, currentPiece, 0x80, inCheck);
-				}
-			}
-		}
-		else if (rank == PieceRank::KING)
-		{
-			GenerateKingMovesAt(currentPiece, position, inCheck);
-		}
-		else if (rank == PieceRank::PAWN)
-		{
-			GeneratePawnMovesAt(currentPiece, position, inCheck);
-		}
+void MoveGenerator::GenerateEvasions(Board& position, uint64_t pieces, GenerationType type, CheckInfo& checkInfo,
+	MoveList& moveList)
+{
+	uint64_t evasionTargets;
 
-		pieces = pieces & ~currentPiece;
+	if ((pieces & checkInfo.KingLocation) != 0x0000000000000000ULL)
+	{
+		GenerateKingMovesAt(checkInfo.KingLocation, position, GetTypeTargets(position, type), false, moveList);
 	}
 
-	return moveList;
+	// in double check only the king can move
+
+	if (PopCount(checkInfo.Checkers) == 1)
+	{
+		// otherwise the checker has to be captured or, if it is a slider, blocked
+
+		evasionTargets = checkInfo.Checkers | Attacks::GetBetween(checkInfo.KingIndex, GetLSB(checkInfo.Checkers));
+
+		GeneratePieceMoves(position, pieces & ~checkInfo.KingLocation, evasionTargets, type, checkInfo, moveList);
+	}
 }
 
-bool MoveGenerator::IsPiecePinned(Board& position, uint64_t location, int offset)
+void MoveGenerator::GeneratePieceMoves(Board& position, uint64_t pieces, uint64_t targetMask, GenerationType type,
+	CheckInfo& checkInfo, MoveList& moveList)
 {
-	bool result = true;
-	int locationMaskIndex;
-	PieceColor pinningColor =
-		Position::GetColorAt(position, location) == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
-	uint64_t pinMask;
-	uint64_t pinnedKingLocation;
-	uint64_t mask;
-	uint64_t occupancy;
-	uint64_t tmpLocation;
-	uint64_t guard;
-	bool goUp;
+	uint64_t currentPiece;
+	uint64_t allowedTargets;
+	uint64_t typeTargets = GetTypeTargets(position, type);
+	int currentIndex;
+	PieceRank rank;
 
-	if (PopCount(location) == 1)
+	while (pieces != 0x0000000000000000ULL)
 	{
-		if (pinningColor == PieceColor::WHITE)
-		{
-			if (offset == 8 || offset == 1)
-			{
-				pinMask = position.WhiteQueens | position.WhiteRooks;
-			}
-			else
-			{
-				pinMask = position.WhiteQueens | position.WhiteBishops;
-			}
-
-			pinnedKingLocation = position.BlackKing;
-		}
-		else
-		{
-			if (offset == 8 || offset == 1)
-			{
-				pinMask = position.BlackQueens | position.BlackRooks;
-			}
-			else
-			{
-				pinMask = position.BlackQueens | position.BlackBishops;
-			}
+		currentIndex = GetLSB(pieces);
+		currentPiece = 0x0000000000000001ULL << currentIndex;
+		rank = GetRankAt(position, currentPiece);
 
-			pinnedKingLocation = position.WhiteKing;
-		}
+		// a pinned piece may only move along the line between its king and the pinner
 
-		locationMaskIndex = GetLSB(location);
+		allowedTargets = targetMask;
 
-		if (offset == 8)
+		if ((checkInfo.Pinned & currentPiece) != 0x0000000000000000ULL)
 		{
-			mask = FileMask[locationMaskIndex];
+			allowedTargets = allowedTargets & Attacks::GetLine(checkInfo.KingIndex, currentIndex);
 		}
-		else if (offset == 1)
+
+		if (rank == PieceRank::KNIGHT)
 		{
-			mask = RankMask[locationMaskIndex];
+			if ((checkInfo.Pinned & currentPiece) == 0x0000000000000000ULL)
+			{
+				GenerateKnightMovesAt(currentPiece, position, allowedTargets & typeTargets, moveList);
+			}
 		}
-		else if (offset == 9)
+		else if (rank == PieceRank::BISHOP || rank == PieceRank::ROOK || rank == PieceRank::QUEEN)
 		{
-			mask = SWNEMask[locationMaskIndex];
+			GenerateSlidingMovesAt(position, currentPiece, rank, allowedTargets & typeTargets, moveList);
 		}
-		else if (offset == 7)
+		else if (rank == PieceRank::KING)
 		{
-			mask = NWSEMask[locationMaskIndex];
+			GenerateKingMovesAt(currentPiece, position, typeTargets,
+				checkInfo.Checkers == 0x0000000000000000ULL && type != GenerationType::CAPTURES, moveList);
 		}
-		else
+		else if (rank == PieceRank::PAWN)
 		{
-			mask = 0x0000000000000000UL;
+			// pawns need the type itself: promotions count as captures whatever the target
+			GeneratePawnMovesAt(currentPiece, position, allowedTargets, type, moveList);
 		}
 
-		if ((GetColorAt(position, location) == PieceColor::WHITE
-			&& (mask & pinnedKingLocation) != 0x0000000000000000UL
-			&& (mask & pinMask) != 0x0000000000000000UL)
-			|| (GetColorAt(position, location) == PieceColor::BLACK
-				&& (mask & pinnedKingLocation) != 0x0000000000000000UL
-				&& (mask & pinMask) != 0x0000000000000000UL))
-		{
-
-			occupancy = (position.WhitePieces | position.BlackPieces) & mask;
-
-			if (pinnedKingLocation < location)
-			{
-				goUp = true;
+		pieces = pieces & ~currentPiece;
+	}
+}
 
-				if (offset == 9)
-				{
-					guard = 0x007F7F7F7F7F7F7FUL;
-				}
-				else if (offset == 1)
-				{
-					guard = 0x7F7F7F7F7F7F7F7FUL;
-				}
-				else if (offset == 8)
-				{
-					guard = 0x00FFFFFFFFFFFFFFUL;
-				}
-				else if (offset == 7)
-				{
-					guard = 0x00FEFEFEFEFEFEFEUL;
-				}
-				else
-				{
-					guard = 0x0000000000000000UL;
-				}
-			}
-			else
-			{
-				goUp = false;
+void MoveGenerator::GetCheckInfo(Board& position, CheckInfo& info)
+{
+	PieceColor opposingColor = position.ColorToMove == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
+	uint64_t ownPieces = position.ColorToMove == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
+	uint64_t opposingPieces = position.ColorToMove == PieceColor::WHITE ? position.BlackPieces : position.WhitePieces;
+	uint64_t opposingQueens =
+		position.ColorToMove == PieceColor::WHITE ? position.BlackQueens : position.WhiteQueens;
+	uint64_t opposingRooks =
+		position.ColorToMove == PieceColor::WHITE ? position.BlackRooks : position.WhiteRooks;
+	uint64_t opposingBishops =
+		position.ColorToMove == PieceColor::WHITE ? position.BlackBishops : position.WhiteBishops;
+	uint64_t snipers;
+	uint64_t blockers;
+	int sniperIndex;
 
-				if (offset == 9)
-				{
-					guard = 0xFEFEFEFEFEFEFE00UL;
-				}
-				else if (offset == 1)
-				{
-					guard = 0xFEFEFEFEFEFEFEFEUL;
-				}
-				else if (offset == 8)
-				{
-					guard = 0xFFFFFFFFFFFFFF00UL;
-				}
-				else if (offset == 7)
-				{
-					guard = 0x7F7F7F7F7F7F7F00UL;
-				}
-				else
-				{
-					guard = 0x0000000000000000UL;
-				}
-			}
+	info.KingLocation = position.ColorToMove == PieceColor::WHITE ? position.WhiteKing : position.BlackKing;
+	info.KingIndex = GetLSB(info.KingLocation);
+	info.Pinned = 0x0000000000000000ULL;
+	info.Checkers = GetAttackersTo(position, info.KingIndex,
+		position.WhitePieces | position.BlackPieces, opposingColor);
 
-			if ((pinnedKingLocation & guard) != 0x0000000000000000UL)
-			{
-				tmpLocation = goUp ? pinnedKingLocation << offset : pinnedKingLocation >> offset;
+	// x-ray from the king through our own pieces; any enemy slider seen that way with
+	// exactly one of our pieces in between is pinning that piece
 
-				while (tmpLocation != location)
-				{
-					if ((tmpLocation & occupancy) != 0x0000000000000000UL)
-					{
-						result = false;
-						break;
-					}
+	snipers = (Attacks::GetRookAttacks(info.KingIndex, opposingPieces) & (opposingRooks | opposingQueens))
+		| (Attacks::GetBishopAttacks(info.KingIndex, opposingPieces) & (opposingBishops | opposingQueens));
 
-					tmpLocation = goUp ? tmpLocation << offset : tmpLocation >> offset;
-				}
+	while (snipers != 0x0000000000000000ULL)
+	{
+		sniperIndex = GetLSB(snipers);
+		blockers = Attacks::GetBetween(info.KingIndex, sniperIndex) & (ownPieces | opposingPieces);
 
-				if (result && (tmpLocation & guard) != 0x0000000000000000UL)
-				{
-					tmpLocation = goUp ? tmpLocation << offset : tmpLocation >> offset;
-
-					while (true)
-					{
-						if ((tmpLocation & occupancy) != 0x0000000000000000UL)
-						{
-							if ((tmpLocation & pinMask) == 0x0000000000000000UL)
-							{
-								result = false;
-								break;
-							}
-							else
-							{
-								break;
-							}
-						}
-						else
-						{
-							if ((tmpLocation & guard) != 0x0000000000000000UL)
-							{
-								tmpLocation = goUp ? tmpLocation << offset : tmpLocation >> offset;
-							}
-							else
-							{
-								result = false;
-								break;
-							}
-						}
-					}
-				}
-				else
-				{
-					result = false;
-				}
-			}
-			else
-			{
-				result = false;
-			}
-		}
-		else
+		if (PopCount(blockers) == 1 && (blockers & ownPieces) != 0x0000000000000000ULL)
 		{
-			result = false;
+			info.Pinned = info.Pinned | blockers;
 		}
-	}
-	else
-	{
-		result = false;
-	}
-
-	return result;
-}
 
-bool MoveGenerator::IsPiecePinnedNWSE(Board& position, uint64_t location)
-{
-	return IsPiecePinned(position, location, 7);
+		snipers = snipers & (snipers - 1);
+	}
 }
 
-bool MoveGenerator::IsPiecePinnedSWNE(Board& position, uint64_t location)
+uint64_t MoveGenerator::GetAttackersTo(Board& position, int square, uint64_t occupancy, PieceColor color)
 {
-	return IsPiecePinned(position, location, 9);
-}
+	uint64_t location = 0x0000000000000001ULL << square;
+	uint64_t attackers;
 
-bool MoveGenerator::IsPiecePinnedRank(Board& position, uint64_t location)
-{
-	return IsPiecePinned(position, location, 1);
-}
+	if (color == PieceColor::WHITE)
+	{
+		attackers = (KnightAttacks[square] & position.WhiteKnights)
+			| (KingAttacks[square] & position.WhiteKing)
+			| (Attacks::GetRookAttacks(square, occupancy) & (position.WhiteRooks | position.WhiteQueens))
+			| (Attacks::GetBishopAttacks(square, occupancy) & (position.WhiteBishops | position.WhiteQueens))
+			| ((((location & 0xFEFEFEFEFEFEFE00ULL) >> 9) | ((location & 0x7F7F7F7F7F7F7F00ULL) >> 7))
+				& position.WhitePawns);
+	}
+	else
+	{
+		attackers = (KnightAttacks[square] & position.BlackKnights)
+			| (KingAttacks[square] & position.BlackKing)
+			| (Attacks::GetRookAttacks(square, occupancy) & (position.BlackRooks | position.BlackQueens))
+			| (Attacks::GetBishopAttacks(square, occupancy) & (position.BlackBishops | position.BlackQueens))
+			| ((((location & 0x00FEFEFEFEFEFEFEULL) << 7) | ((location & 0x007F7F7F7F7F7F7FULL) << 9))
+				& position.BlackPawns);
+	}
 
-bool MoveGenerator::IsPiecePinnedFile(Board& position, uint64_t location)
-{
-	return IsPiecePinned(position, location, 8);
+	return attackers & occupancy;
 }
 
 void MoveGenerator::GenerateSlidingMovesAt(Board& position, uint64_t location,
-	uint16_t direction, bool evade)
+	PieceRank rank, uint64_t allowedTargets, MoveList& moveList)
 {
 	int locationIndex;
 	uint64_t moveMask = 0x0000000000000000ULL;
@@ -676,100 +458,26 @@ void MoveGenerator::GenerateSlidingMovesAt(Board& position, uint64_t location,
 	PieceColor color = GetColorAt(position, location);
 	uint64_t opposingPieces = color == PieceColor::WHITE ? position.BlackPieces : position.WhitePieces;
 	uint64_t ownPieces = color == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
-	int blockerIndex;
+	uint64_t occupancy = position.WhitePieces | position.BlackPieces;
 
 	if (PopCount(location) == 1)
 	{
 		locationIndex = GetLSB(location);
 
-		if (direction == 0x01)
+		if (rank == PieceRank::BISHOP)
 		{
-			moveMask = RayAttacksN[locationIndex];
-			blockerIndex = GetLSB(moveMask & (position.WhitePieces | position.BlackPieces));
-
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksN[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
-		}
-		else if (direction == 0x02)
-		{
-			moveMask = RayAttacksNE[locationIndex];
-			blockerIndex = GetLSB(moveMask & (position.WhitePieces | position.BlackPieces));
-
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksNE[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
-		}
-		else if (direction == 0x04)
-		{
-			moveMask = RayAttacksE[locationIndex];
-			blockerIndex = GetLSB(moveMask & (position.WhitePieces | position.BlackPieces));
-
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksE[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
+			moveMask = Attacks::GetBishopAttacks(locationIndex, occupancy);
 		}
-		else if (direction == 0x08)
+		else if (rank == PieceRank::ROOK)
 		{
-			moveMask = RayAttacksSE[locationIndex];
-			blockerIndex = GetMSB(moveMask & (position.WhitePieces | position.BlackPieces));
-
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksSE[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
+			moveMask = Attacks::GetRookAttacks(locationIndex, occupancy);
 		}
-		else if (direction == 0x10)
-		{
-			moveMask = RayAttacksS[locationIndex];
-			blockerIndex = GetMSB(moveMask & (position.WhitePieces | position.BlackPieces));
-
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksS[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
-		}
-		else if (direction == 0x20)
-		{
-			moveMask = RayAttacksSW[locationIndex];
-			blockerIndex = GetMSB(moveMask & (position.WhitePieces | position.BlackPieces));
-
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksSW[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
-		}
-		else if (direction == 0x40)
+		else if (rank == PieceRank::QUEEN)
 		{
-			moveMask = RayAttacksW[locationIndex];
-			blockerIndex = GetMSB(moveMask & (position.WhitePieces | position.BlackPieces));
-
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksW[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
+			moveMask = Attacks::GetQueenAttacks(locationIndex, occupancy);
 		}
-		else if (direction == 0x80)
-		{
-			moveMask = RayAttacksNW[locationIndex];
-			blockerIndex = GetLSB(moveMask & (position.WhitePieces | position.BlackPieces));
 
-			if (blockerIndex != -1)
-			{
-				moveMask = moveMask & ~RayAttacksNW[blockerIndex];
-				moveMask = moveMask & ~ownPieces;
-			}
-		}
+		moveMask = moveMask & ~ownPieces & allowedTargets;
 	}
 
 	while (moveMask != 0x0000000000000000ULL)
@@ -782,16 +490,54 @@ void MoveGenerator::GenerateSlidingMovesAt(Board& position, uint64_t location,
 			captured = GetRankAt(position, currentMove);
 		}
 
-		AddMove(location, currentMove, GetRankAt(position, location),
-			color, position.HalfMoveCounter, position.CastlingStatus,
-			position.EnPassantTarget, captured, PieceRank::NONE, evade, position);
+		AddMove(location, currentMove, rank, color, captured, PieceRank::NONE, MoveFlags::NONE, moveList);
 
 		moveMask = moveMask & ~currentMove;
 	}
 }
 
-void MoveGenerator::GeneratePawnMovesAt(uint64_t location, Board& position, bool evade)
+static void AddPawnMoves(uint64_t src, uint64_t tgt, PieceRank captured, int flags, uint64_t backRankMask,
+	Board& position, MoveList& moveList)
+{
+	if ((tgt & backRankMask) == 0x0000000000000000UL)
+	{
+		MoveGenerator::AddMove(src, tgt, PieceRank::PAWN, position.ColorToMove, captured, PieceRank::NONE, flags,
+			moveList);
+	}
+	else
+	{
+		MoveGenerator::AddMove(src, tgt, PieceRank::PAWN, position.ColorToMove, captured, PieceRank::QUEEN, flags,
+			moveList);
+
+		MoveGenerator::AddMove(src, tgt, PieceRank::PAWN, position.ColorToMove, captured, PieceRank::ROOK, flags,
+			moveList);
+
+		MoveGenerator::AddMove(src, tgt, PieceRank::PAWN, position.ColorToMove, captured, PieceRank::BISHOP, flags,
+			moveList);
+
+		MoveGenerator::AddMove(src, tgt, PieceRank::PAWN, position.ColorToMove, captured, PieceRank::KNIGHT, flags,
+			moveList);
+	}
+}
+
+static bool IsEnPassantLegal(uint64_t src, uint64_t tgt, Board& position)
+{
+	uint64_t capturedLocation = position.ColorToMove == PieceColor::WHITE ? tgt >> 8 : tgt << 8;
+	uint64_t ownKing = position.ColorToMove == PieceColor::WHITE ? position.WhiteKing : position.BlackKing;
+	uint64_t occupancy = ((position.WhitePieces | position.BlackPieces) & ~src & ~capturedLocation) | tgt;
+
+	// both pawns leave their squares at once, which can uncover the king along the rank
+	// (or resolve a check by the double-pushed pawn), so test the resulting occupancy directly
+
+	return MoveGenerator::GetAttackersTo(position, GetLSB(ownKing), occupancy,
+		position.ColorToMove == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE) == 0x0000000000000000ULL;
+}
+
+void MoveGenerator::GeneratePawnMovesAt(uint64_t location, Board& position, uint64_t allowedTargets,
+	GenerationType type, MoveList& moveList)
 {
+	uint64_t occupancy = position.WhitePieces | position.BlackPieces;
+
 	uint64_t advancedLocation = position.ColorToMove == PieceColor::WHITE ? location << 8 : location >> 8;
 	uint64_t doubleAdvancedLocation =
 		position.ColorToMove == PieceColor::WHITE ? location << 16 : location >> 16;
@@ -817,171 +563,76 @@ void MoveGenerator::GeneratePawnMovesAt(uint64_t location, Board& position, bool
 	uint64_t opposingPieces =
 		position.ColorToMove == PieceColor::WHITE ? position.BlackPieces : position.WhitePieces;
 
-	if (!IsPiecePinnedRank(position, location))
-	{
-		if (!IsPiecePinnedNWSE(position, location)
-			&& !IsPiecePinnedSWNE(position, location))
-		{
-			if (((advancedLocation & (position.WhitePieces | position.BlackPieces)) == 0x0000000000000000UL)
-				&& ((doubleAdvancedLocation & (position.WhitePieces | position.BlackPieces))
-					== 0x0000000000000000UL)
-				&& (location & startRankMask) == location)
-			{
-				AddMove(location, doubleAdvancedLocation, PieceRank::PAWN, position.ColorToMove,
-					position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget, PieceRank::NONE,
-					PieceRank::NONE, evade, position);
-			}
+	uint64_t pushTargets = allowedTargets;
+	uint64_t captureTargets = allowedTargets & opposingPieces;
 
-			if (((location & backRankMask) == 0x0000000000000000UL)
-				&& ((advancedLocation & (position.WhitePieces | position.BlackPieces)) == 0x0000000000000000UL))
-			{
-				if ((advancedLocation & backRankMask) == 0x0000000000000000UL)
-				{
-					AddMove(location, advancedLocation, PieceRank::PAWN, position.ColorToMove,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget, PieceRank::NONE,
-						PieceRank::NONE, evade, position);
-				}
-				else
-				{
-					AddMove(location, advancedLocation, PieceRank::PAWN, position.ColorToMove,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget, PieceRank::NONE,
-						PieceRank::QUEEN, evade, position);
+	if ((location & backRankMask) != 0x0000000000000000UL)
+	{
+		return;
+	}
 
-					AddMove(location, advancedLocation, PieceRank::PAWN, position.ColorToMove,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget, PieceRank::NONE,
-						PieceRank::ROOK, evade, position);
+	// captures take every promotion, quiets everything else that doesn't capture
 
-					AddMove(location, advancedLocation, PieceRank::PAWN, position.ColorToMove,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget, PieceRank::NONE,
-						PieceRank::BISHOP, evade, position);
+	if (type == GenerationType::CAPTURES)
+	{
+		pushTargets = pushTargets & backRankMask;
+	}
+	else if (type == GenerationType::QUIETS)
+	{
+		pushTargets = pushTargets & ~backRankMask;
+		captureTargets = 0x0000000000000000UL;
+	}
 
-					AddMove(location, advancedLocation, PieceRank::PAWN, position.ColorToMove,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget, PieceRank::NONE,
-						PieceRank::KNIGHT, evade, position);
-				}
-			}
+	if ((advancedLocation & occupancy) == 0x0000000000000000UL)
+	{
+		if ((advancedLocation & pushTargets) != 0x0000000000000000UL)
+		{
+			AddPawnMoves(location, advancedLocation, PieceRank::NONE, MoveFlags::NONE, backRankMask, position,
+				moveList);
 		}
 
-		if (!IsPiecePinnedFile(position, location))
+		if ((location & startRankMask) != 0x0000000000000000UL
+			&& (doubleAdvancedLocation & occupancy) == 0x0000000000000000UL
+			&& (doubleAdvancedLocation & pushTargets) != 0x0000000000000000UL)
 		{
-			bool isPinned = false;
-
-			if (position.ColorToMove == PieceColor::WHITE && IsPiecePinnedSWNE(position, location))
-			{
-				isPinned = true;
-			}
-
-			if (position.ColorToMove == PieceColor::BLACK && IsPiecePinnedSWNE(position, location))
-			{
-				isPinned = true;
-			}
-
-			if (!isPinned)
-			{
-				if (((location & (leftEdgeMask | backRankMask)) == 0x0000000000000000UL)
-					&& ((captureLeftLocation & (opposingPieces | position.EnPassantTarget)) != 0x0000000000000000UL))
-				{
-					PieceRank captured = GetRankAt(position, captureLeftLocation);
-
-					if ((captureLeftLocation & position.EnPassantTarget) != 0x0000000000000000UL)
-					{
-						evade = true;
-						captured = PieceRank::PAWN;
-					}
-
-					if ((captureLeftLocation & backRankMask) == 0x0000000000000000UL)
-					{
-						AddMove(location, captureLeftLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::NONE,
-							evade, position);
-					}
-					else
-					{
-						AddMove(location, captureLeftLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::QUEEN,
-							evade, position);
-
-						AddMove(location, captureLeftLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::ROOK,
-							evade, position);
-
-						AddMove(location, captureLeftLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::BISHOP,
-							evade, position);
-
-						AddMove(location, captureLeftLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::KNIGHT,
-							evade, position);
-					}
-				}
-			}
-
-			isPinned = false;
-
-			if (position.ColorToMove == PieceColor::WHITE && IsPiecePinnedNWSE(position, location))
-			{
-				isPinned = true;
-			}
+			AddMove(location, doubleAdvancedLocation, PieceRank::PAWN, position.ColorToMove, PieceRank::NONE,
+				PieceRank::NONE, MoveFlags::DOUBLE_PUSH, moveList);
+		}
+	}
 
-			if (position.ColorToMove == PieceColor::BLACK && IsPiecePinnedNWSE(position, location))
-			{
-				isPinned = true;
-			}
+	if ((location & leftEdgeMask) == 0x0000000000000000UL)
+	{
+		if ((captureLeftLocation & captureTargets) != 0x0000000000000000UL)
+		{
+			AddPawnMoves(location, captureLeftLocation, GetRankAt(position, captureLeftLocation),
+				MoveFlags::NONE, backRankMask, position, moveList);
+		}
+		else if ((captureLeftLocation & position.EnPassantTarget) != 0x0000000000000000UL
+			&& type != GenerationType::QUIETS && IsEnPassantLegal(location, captureLeftLocation, position))
+		{
+			AddPawnMoves(location, captureLeftLocation, PieceRank::PAWN, MoveFlags::EN_PASSANT, backRankMask,
+				position, moveList);
+		}
+	}
 
-			if (!isPinned)
-			{
-				if (((location & (rightEdgeMask | backRankMask)) == 0x0000000000000000UL)
-					&& ((captureRightLocation & (opposingPieces | position.EnPassantTarget)) != 0x0000000000000000UL))
-				{
-					PieceRank captured = GetRankAt(position, captureRightLocation);
-
-					if ((captureRightLocation & position.EnPassantTarget) != 0x0000000000000000UL)
-					{
-						evade = true;
-						captured = PieceRank::PAWN;
-					}
-
-					if ((captureRightLocation & backRankMask) == 0x0000000000000000UL)
-					{
-						AddMove(location, captureRightLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::NONE,
-							evade, position);
-					}
-					else
-					{
-						AddMove(location, captureRightLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::QUEEN,
-							evade, position);
-
-						AddMove(location, captureRightLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::ROOK,
-							evade, position);
-
-						AddMove(location, captureRightLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::BISHOP,
-							evade, position);
-
-						AddMove(location, captureRightLocation, PieceRank::PAWN,
-							position.ColorToMove, position.HalfMoveCounter, position.CastlingStatus,
-							position.EnPassantTarget, captured, PieceRank::KNIGHT,
-							evade, position);
-					}
-				}
-			}
+	if ((location & rightEdgeMask) == 0x0000000000000000UL)
+	{
+		if ((captureRightLocation & captureTargets) != 0x0000000000000000UL)
+		{
+			AddPawnMoves(location, captureRightLocation, GetRankAt(position, captureRightLocation),
+				MoveFlags::NONE, backRankMask, position, moveList);
+		}
+		else if ((captureRightLocation & position.EnPassantTarget) != 0x0000000000000000UL
+			&& type != GenerationType::QUIETS && IsEnPassantLegal(location, captureRightLocation, position))
+		{
+			AddPawnMoves(location, captureRightLocation, PieceRank::PAWN, MoveFlags::EN_PASSANT, backRankMask,
+				position, moveList);
 		}
 	}
 }
 
-void MoveGenerator::GenerateKnightMovesAt(uint64_t location, Board& position, bool evade)
+void MoveGenerator::GenerateKnightMovesAt(uint64_t location, Board& position, uint64_t allowedTargets,
+	MoveList& moveList)
 {
 	int locationIndex;
 	uint64_t moveMask = 0x0000000000000000ULL;
@@ -995,7 +646,7 @@ void MoveGenerator::GenerateKnightMovesAt(uint64_t location, Board& position, bo
 	{
 		locationIndex = GetLSB(location);
 
-		moveMask = KnightAttacks[locationIndex] & ~ownPieces;
+		moveMask = KnightAttacks[locationIndex] & ~ownPieces & allowedTargets;
 	}
 
 	while (moveMask != 0x0000000000000000ULL)
@@ -1008,35 +659,40 @@ void MoveGenerator::GenerateKnightMovesAt(uint64_t location, Board& position, bo
 			captured = GetRankAt(position, currentMove);
 		}
 
-		AddMove(location, currentMove, PieceRank::KNIGHT, color, position.HalfMoveCounter,
-			position.CastlingStatus, position.EnPassantTarget, captured, PieceRank::NONE, evade, position);
+		AddMove(location, currentMove, PieceRank::KNIGHT, color, captured, PieceRank::NONE, MoveFlags::NONE, moveList);
 
 		moveMask = moveMask & ~currentMove;
 	}
 }
 
-void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, bool evade)
+void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, uint64_t allowedTargets,
+	bool includeCastling, MoveList& moveList)
 {
 	int locationIndex;
 	uint64_t moveMask = 0x0000000000000000ULL;
 	uint64_t currentMove;
 	PieceColor color = GetColorAt(position, location);
+	PieceColor opposingColor = color == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
 	uint64_t opposingPieces = color == PieceColor::WHITE ? position.BlackPieces : position.WhitePieces;
 	uint64_t ownPieces = color == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
+	uint64_t occupancy = position.WhitePieces | position.BlackPieces;
 
 
 	if (PopCount(location) == 1)
 	{
 		locationIndex = GetLSB(location);
 
-		moveMask = KingAttacks[locationIndex] & ~ownPieces;
+		moveMask = KingAttacks[locationIndex] & ~ownPieces & allowedTargets;
 	}
 
 	while (moveMask != 0x0000000000000000ULL)
 	{
 		currentMove = 0x0000000000000001ULL << GetLSB(moveMask);
 
-		if (!IsSquareAttacked(currentMove, position))
+		// the king is taken off the board so it can't hide behind itself from a slider
+
+		if (GetAttackersTo(position, GetLSB(currentMove), occupancy & ~location, opposingColor)
+			== 0x0000000000000000ULL)
 		{
 			PieceRank captured = PieceRank::NONE;
 
@@ -1045,13 +701,18 @@ void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, bool
 				captured = GetRankAt(position, currentMove);
 			}
 
-			AddMove(location, currentMove, PieceRank::KING, color, position.HalfMoveCounter,
-				position.CastlingStatus, position.EnPassantTarget, captured, PieceRank::NONE, evade, position);
+			AddMove(location, currentMove, PieceRank::KING, color, captured, PieceRank::NONE, MoveFlags::NONE,
+				moveList);
 		}
 
 		moveMask = moveMask & ~currentMove;
 	}
 
+	if (!includeCastling)
+	{
+		return;
+	}
+
 	if (color == PieceColor::WHITE)
 	{
 		if ((position.CastlingStatus & CastlingFlags::WHITE_SHORT) != 0)
@@ -1060,12 +721,10 @@ void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, bool
 				== 0x0000000000000000UL)
 			{
 				if (!IsSquareAttacked(0x0000000000000040ULL, position)
-					&& !IsSquareAttacked(0x0000000000000020ULL, position)
-					&& !IsSquareAttacked(0x0000000000000010ULL, position))
+					&& !IsSquareAttacked(0x0000000000000020ULL, position))
 				{
 					AddMove(0x0000000000000010ULL, 0x0000000000000040ULL, PieceRank::KING, color,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget,
-						PieceRank::NONE, PieceRank::NONE, evade, position);
+						PieceRank::NONE, PieceRank::NONE, MoveFlags::CASTLE, moveList);
 				}
 			}
 		}
@@ -1076,12 +735,10 @@ void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, bool
 				== 0x0000000000000000ULL)
 			{
 				if (!IsSquareAttacked(0x0000000000000008ULL, position)
-					&& !IsSquareAttacked(0x0000000000000004ULL, position)
-					&& !IsSquareAttacked(0x0000000000000010ULL, position))
+					&& !IsSquareAttacked(0x0000000000000004ULL, position))
 				{
 					AddMove(0x0000000000000010ULL, 0x0000000000000004ULL, PieceRank::KING, color,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget,
-						PieceRank::NONE, PieceRank::NONE, evade, position);
+						PieceRank::NONE, PieceRank::NONE, MoveFlags::CASTLE, moveList);
 				}
 			}
 		}
@@ -1094,12 +751,10 @@ void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, bool
 				== 0x0000000000000000ULL)
 			{
 				if (!IsSquareAttacked(0x4000000000000000ULL, position)
-					&& !IsSquareAttacked(0x2000000000000000ULL, position)
-					&& !IsSquareAttacked(0x1000000000000000ULL, position))
+					&& !IsSquareAttacked(0x2000000000000000ULL, position))
 				{
 					AddMove(0x1000000000000000ULL, 0x4000000000000000ULL, PieceRank::KING, color,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget,
-						PieceRank::NONE, PieceRank::NONE, evade, position);
+						PieceRank::NONE, PieceRank::NONE, MoveFlags::CASTLE, moveList);
 				}
 			}
 		}
@@ -1110,12 +765,10 @@ void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, bool
 				== 0x0000000000000000ULL)
 			{
 				if (!IsSquareAttacked(0x0800000000000000ULL, position)
-					&& !IsSquareAttacked(0x0400000000000000ULL, position)
-					&& !IsSquareAttacked(0x1000000000000000ULL, position))
+					&& !IsSquareAttacked(0x0400000000000000ULL, position))
 				{
 					AddMove(0x1000000000000000ULL, 0x0400000000000000ULL, PieceRank::KING, color,
-						position.HalfMoveCounter, position.CastlingStatus, position.EnPassantTarget,
-						PieceRank::NONE, PieceRank::NONE, evade, position);
+						PieceRank::NONE, PieceRank::NONE, MoveFlags::CASTLE, moveList);
 				}
 			}
 		}
@@ -1124,167 +777,331 @@ void MoveGenerator::GenerateKingMovesAt(uint64_t location, Board& position, bool
 
 bool MoveGenerator::IsSquareAttacked(uint64_t square, Board& position)
 {
-	bool result = false;
-	int squareIndex = GetLSB(square);
-	int blockerIndex;
-	uint64_t opposingKnights =
-		position.ColorToMove == PieceColor::WHITE ? position.BlackKnights : position.WhiteKnights;
-	uint64_t opposingBishops =
-		position.ColorToMove == PieceColor::WHITE ? position.BlackBishops : position.WhiteBishops;
-	uint64_t opposingRooks =
-		position.ColorToMove == PieceColor::WHITE ? position.BlackRooks : position.WhiteRooks;
-	uint64_t opposingQueens =
-		position.ColorToMove == PieceColor::WHITE ? position.BlackQueens : position.WhiteQueens;
+	PieceColor opposingColor = position.ColorToMove == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
 
+	return GetAttackersTo(position, GetLSB(square), position.WhitePieces | position.BlackPieces, opposingColor)
+		!= 0x0000000000000000ULL;
+}
+
+void MoveGenerator::AddMove(uint64_t src, uint64_t tgt, PieceRank rank, PieceColor color, PieceRank capture,
+	PieceRank promotion, int flags, MoveList& moveList)
+{
+	MoveUtil::InitializeMove(moveList.Moves[moveList.Count], GetLSB(src), GetLSB(tgt), color, rank, capture,
+		promotion, flags);
+	moveList.Count++;
+}
 
-	if ((KnightAttacks[squareIndex] & opposingKnights) != 0x0000000000000000ULL)
+// whether a move checks the opponent, worked out without making it. the rook's part of
+// castling and the pawn taken en passant aren't modelled, so those count as checks
+bool MoveGenerator::GivesCheck(Board& position, Move move)
+{
+	uint64_t source = MoveUtil::GetSourceLocation(move);
+	uint64_t target = MoveUtil::GetTargetLocation(move);
+	uint64_t occupancy = ((position.WhitePieces | position.BlackPieces) & ~source) | target;
+	uint64_t king = position.ColorToMove == PieceColor::WHITE ? position.BlackKing : position.WhiteKing;
+	int kingIndex = GetLSB(king);
+	uint64_t rooks;
+	uint64_t bishops;
+	uint64_t pawnCheckSquares;
+	PieceRank piece = MoveUtil::GetPromotedRank(move) != PieceRank::NONE
+		? MoveUtil::GetPromotedRank(move) : MoveUtil::GetMovingPiece(move);
+
+	if ((MoveUtil::GetFlags(move) & (MoveFlags::CASTLE | MoveFlags::EN_PASSANT)) != 0)
 	{
-		result = true;
+		return true;
 	}
 
-	blockerIndex = GetLSB(RayAttacksN[squareIndex] & (position.WhitePieces | position.BlackPieces));
-
-	if (blockerIndex != -1)
+	if (position.ColorToMove == PieceColor::WHITE)
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingRooks | opposingQueens))
-			!= 0x0000000000000000ULL)
-		{
-			result = true;
-		}
+		rooks = position.WhiteRooks | position.WhiteQueens;
+		bishops = position.WhiteBishops | position.WhiteQueens;
+		pawnCheckSquares = ((king & 0xFEFEFEFEFEFEFE00ULL) >> 9) | ((king & 0x7F7F7F7F7F7F7F00ULL) >> 7);
+	}
+	else
+	{
+		rooks = position.BlackRooks | position.BlackQueens;
+		bishops = position.BlackBishops | position.BlackQueens;
+		pawnCheckSquares = ((king & 0x00FEFEFEFEFEFEFEULL) << 7) | ((king & 0x007F7F7F7F7F7F7FULL) << 9);
 	}
 
-	blockerIndex = GetLSB(RayAttacksNE[squareIndex] & (position.WhitePieces | position.BlackPieces));
+	// looking out from the king through the new occupancy finds direct slider checks and
+	// discovered ones alike
+
+	rooks = rooks & ~source;
+	bishops = bishops & ~source;
 
-	if (blockerIndex != -1)
+	if (piece == PieceRank::ROOK || piece == PieceRank::QUEEN)
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingBishops | opposingQueens))
-			!= 0x0000000000000000ULL)
-		{
-			result = true;
-		}
+		rooks = rooks | target;
 	}
 
-	blockerIndex = GetLSB(RayAttacksE[squareIndex] & (position.WhitePieces | position.BlackPieces));
+	if (piece == PieceRank::BISHOP || piece == PieceRank::QUEEN)
+	{
+		bishops = bishops | target;
+	}
 
-	if (blockerIndex != -1)
+	if ((Attacks::GetRookAttacks(kingIndex, occupancy) & rooks) != 0x0000000000000000ULL
+		|| (Attacks::GetBishopAttacks(kingIndex, occupancy) & bishops) != 0x0000000000000000ULL)
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingRooks | opposingQueens))
-			!= 0x0000000000000000ULL)
-		{
-			result = true;
-		}
+		return true;
 	}
 
-	blockerIndex = GetMSB(RayAttacksSE[squareIndex] & (position.WhitePieces | position.BlackPieces));
+	if (piece == PieceRank::KNIGHT)
+	{
+		return (KnightAttacks[kingIndex] & target) != 0x0000000000000000ULL;
+	}
 
-	if (blockerIndex != -1)
+	if (piece == PieceRank::PAWN)
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingBishops | opposingQueens))
-			!= 0x0000000000000000ULL)
-		{
-			result = true;
-		}
+		return (pawnCheckSquares & target) != 0x0000000000000000ULL;
 	}
 
-	blockerIndex = GetMSB(RayAttacksS[squareIndex] & (position.WhitePieces | position.BlackPieces));
+	return false;
+}
 
-	if (blockerIndex != -1)
+bool MoveGenerator::IsLegalMove(Board& position, Move move)
+{
+	uint64_t source = MoveUtil::GetSourceLocation(move);
+	uint64_t ownPieces = position.ColorToMove == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
+	MoveList moveList;
+	CheckInfo checkInfo;
+
+	if (MoveUtil::IsNullMove(move) || MoveUtil::GetMoveColor(move) != position.ColorToMove
+		|| (source & ownPieces) == 0x0000000000000000ULL
+		|| GetRankAt(position, source) != MoveUtil::GetMovingPiece(move))
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingRooks | opposingQueens))
-			!= 0x0000000000000000ULL)
-		{
-			result = true;
-		}
+		return false;
 	}
 
-	blockerIndex = GetMSB(RayAttacksSW[squareIndex] & (position.WhitePieces | position.BlackPieces));
+	// moves from another position (hash table, killers) are checked by generating
+	// the legal moves of the one piece involved and looking for an exact match
+
+	moveList.Count = 0;
+
+	GetCheckInfo(position, checkInfo);
 
-	if (blockerIndex != -1)
+	if (checkInfo.Checkers != 0x0000000000000000ULL)
+	{
+		GenerateEvasions(position, source, GenerationType::ALL, checkInfo, moveList);
+	}
+	else
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingBishops | opposingQueens))
-			!= 0x0000000000000000ULL)
+		GeneratePieceMoves(position, source, 0xFFFFFFFFFFFFFFFFULL, GenerationType::ALL, checkInfo, moveList);
+	}
+
+	for (int i = 0; i < moveList.Count; i++)
+	{
+		if (moveList.Moves[i] == move)
 		{
-			result = true;
+			return true;
 		}
 	}
 
-	blockerIndex = GetMSB(RayAttacksW[squareIndex] & (position.WhitePieces | position.BlackPieces));
+	return false;
+}
 
-	if (blockerIndex != -1)
+// the same pawn moves GeneratePawnMovesAt would produce, counted a whole set of pawns at a
+// time; en passant is left to the caller
+static int CountPawnMoves(Board& position, uint64_t pawns, uint64_t allowedTargets)
+{
+	uint64_t empty = ~(position.WhitePieces | position.BlackPieces);
+	uint64_t opposingPieces =
+		position.ColorToMove == PieceColor::WHITE ? position.BlackPieces : position.WhitePieces;
+	uint64_t backRankMask =
+		position.ColorToMove == PieceColor::WHITE ? 0xFF00000000000000ULL : 0x00000000000000FFULL;
+	uint64_t pushes;
+	uint64_t doublePushes;
+	uint64_t leftCaptures;
+	uint64_t rightCaptures;
+
+	if (position.ColorToMove == PieceColor::WHITE)
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingRooks | opposingQueens))
-			!= 0x0000000000000000ULL)
-		{
-			result = true;
-		}
+		pushes = (pawns << 8) & empty;
+		doublePushes = ((pushes & 0x0000000000FF0000ULL) << 8) & empty;
+		leftCaptures = ((pawns & ~0x0101010101010101ULL) << 7) & opposingPieces;
+		rightCaptures = ((pawns & ~0x8080808080808080ULL) << 9) & opposingPieces;
 	}
+	else
+	{
+		pushes = (pawns >> 8) & empty;
+		doublePushes = ((pushes & 0x0000FF0000000000ULL) >> 8) & empty;
+		leftCaptures = ((pawns & ~0x8080808080808080ULL) >> 7) & opposingPieces;
+		rightCaptures = ((pawns & ~0x0101010101010101ULL) >> 9) & opposingPieces;
+	}
+
+	// the intermediate square of a double push only has to be empty, not allowed
+
+	pushes = pushes & allowedTargets;
+	doublePushes = doublePushes & allowedTargets;
+	leftCaptures = leftCaptures & allowedTargets;
+	rightCaptures = rightCaptures & allowedTargets;
+
+	// every move onto the back rank is four promotions
 
-	blockerIndex = GetLSB(RayAttacksNW[squareIndex] & (position.WhitePieces | position.BlackPieces));
+	return PopCount(pushes & ~backRankMask) + 4 * PopCount(pushes & backRankMask)
+		+ PopCount(leftCaptures & ~backRankMask) + 4 * PopCount(leftCaptures & backRankMask)
+		+ PopCount(rightCaptures & ~backRankMask) + 4 * PopCount(rightCaptures & backRankMask)
+		+ PopCount(doublePushes);
+}
 
-	if (blockerIndex != -1)
+int MoveGenerator::CountLegalMoves(Board& position)
+{
+	CheckInfo checkInfo;
+	PieceColor opposingColor = position.ColorToMove == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
+	uint64_t ownPieces = position.ColorToMove == PieceColor::WHITE ? position.WhitePieces : position.BlackPieces;
+	uint64_t occupancy = position.WhitePieces | position.BlackPieces;
+	uint64_t ownPawns = position.ColorToMove == PieceColor::WHITE ? position.WhitePawns : position.BlackPawns;
+	uint64_t ownKnights = position.ColorToMove == PieceColor::WHITE ? position.WhiteKnights : position.BlackKnights;
+	uint64_t ownDiagonals = position.ColorToMove == PieceColor::WHITE
+		? position.WhiteBishops | position.WhiteQueens : position.BlackBishops | position.BlackQueens;
+	uint64_t ownStraights = position.ColorToMove == PieceColor::WHITE
+		? position.WhiteRooks | position.WhiteQueens : position.BlackRooks | position.BlackQueens;
+	uint64_t targetMask = ~ownPieces;
+	uint64_t kingTargets;
+	uint64_t pieces;
+	uint64_t allowedTargets;
+	uint64_t enPassantPawns;
+	int index;
+	int count = 0;
+
+	GetCheckInfo(position, checkInfo);
+
+	// king moves are the only ones that still need testing square by square
+
+	kingTargets = KingAttacks[checkInfo.KingIndex] & ~ownPieces;
+
+	while (kingTargets != 0x0000000000000000ULL)
 	{
-		if (((0x0000000000000001ULL << blockerIndex) & (opposingBishops | opposingQueens))
-			!= 0x0000000000000000ULL)
+		if (GetAttackersTo(position, GetLSB(kingTargets), occupancy & ~checkInfo.KingLocation, opposingColor)
+			== 0x0000000000000000ULL)
 		{
-			result = true;
+			count++;
 		}
+
+		kingTargets = kingTargets & (kingTargets - 1);
 	}
 
-	if (position.ColorToMove == PieceColor::WHITE)
+	if (checkInfo.Checkers != 0x0000000000000000ULL)
 	{
-		if (((((square & 0x00FEFEFEFEFEFEFEULL) << 7) & position.BlackPawns) != 0x0000000000000000ULL)
-			|| ((((square & 0x007F7F7F7F7F7F7FULL) << 9) & position.BlackPawns) != 0x0000000000000000ULL))
+		if (PopCount(checkInfo.Checkers) > 1)
 		{
-			result = true;
+			return count;
 		}
 
-		if ((KingAttacks[squareIndex] & position.BlackKing) != 0x0000000000000000ULL)
-		{
-			result = true;
-		}
+		targetMask = checkInfo.Checkers | Attacks::GetBetween(checkInfo.KingIndex, GetLSB(checkInfo.Checkers));
 	}
 	else
 	{
-		if (((((square & 0xFEFEFEFEFEFEFE00ULL) >> 9) & position.WhitePawns) != 0x0000000000000000ULL)
-			|| ((((square & 0x7F7F7F7F7F7F7F00ULL) >> 7) & position.WhitePawns) != 0x0000000000000000ULL))
+		if (position.ColorToMove == PieceColor::WHITE)
 		{
-			result = true;
-		}
+			if ((position.CastlingStatus & CastlingFlags::WHITE_SHORT) != 0
+				&& (occupancy & 0x0000000000000060ULL) == 0x0000000000000000ULL
+				&& !IsSquareAttacked(0x0000000000000040ULL, position)
+				&& !IsSquareAttacked(0x0000000000000020ULL, position))
+			{
+				count++;
+			}
 
-		if ((KingAttacks[squareIndex] & position.WhiteKing) != 0x0000000000000000ULL)
+			if ((position.CastlingStatus & CastlingFlags::WHITE_LONG) != 0
+				&& (occupancy & 0x000000000000000EULL) == 0x0000000000000000ULL
+				&& !IsSquareAttacked(0x0000000000000008ULL, position)
+				&& !IsSquareAttacked(0x0000000000000004ULL, position))
+			{
+				count++;
+			}
+		}
+		else
 		{
-			result = true;
+			if ((position.CastlingStatus & CastlingFlags::BLACK_SHORT) != 0
+				&& (occupancy & 0x6000000000000000ULL) == 0x0000000000000000ULL
+				&& !IsSquareAttacked(0x4000000000000000ULL, position)
+				&& !IsSquareAttacked(0x2000000000000000ULL, position))
+			{
+				count++;
+			}
+
+			if ((position.CastlingStatus & CastlingFlags::BLACK_LONG) != 0
+				&& (occupancy & 0x0E00000000000000ULL) == 0x0000000000000000ULL
+				&& !IsSquareAttacked(0x0800000000000000ULL, position)
+				&& !IsSquareAttacked(0x0400000000000000ULL, position))
+			{
+				count++;
+			}
 		}
 	}
 
-	return result;
-}
+	// pinned knights can never move; other pinned pieces stay on the line through their king
 
-void MoveGenerator::AddMove(uint64_t src, uint64_t tgt, PieceRank rank, PieceColor color, int hm, int cs, uint64_t ep,
-	PieceRank capture, PieceRank promotion, bool evade, Board& position)
-{
-	Move m;
-	MoveUtil::InitializeMove(m, tgt, src, ep, color, rank, capture, promotion, hm, cs);
+	pieces = ownKnights & ~checkInfo.Pinned;
+
+	while (pieces != 0x0000000000000000ULL)
+	{
+		count += PopCount(KnightAttacks[GetLSB(pieces)] & targetMask);
+		pieces = pieces & (pieces - 1);
+	}
+
+	pieces = ownDiagonals;
 
-	if (evade)
+	while (pieces != 0x0000000000000000ULL)
 	{
-		Move nullMove;
-		MoveUtil::InitializeMove(nullMove, 0x0000000000000000UL, 0x0000000000000000UL, 0x0000000000000000, PieceColor::NONE,
-			PieceRank::NONE, PieceRank::NONE, PieceRank::NONE, 0, 0);
+		index = GetLSB(pieces);
+		allowedTargets = targetMask;
 
-		Make(position, m);
-		Make(position, nullMove);
+		if ((checkInfo.Pinned & (0x0000000000000001ULL << index)) != 0x0000000000000000ULL)
+		{
+			allowedTargets = allowedTargets & Attacks::GetLine(checkInfo.KingIndex, index);
+		}
 
-		if (!IsSquareAttacked(color == PieceColor::WHITE ? position.WhiteKing : position.BlackKing, position))
+		count += PopCount(Attacks::GetBishopAttacks(index, occupancy) & allowedTargets);
+		pieces = pieces & (pieces - 1);
+	}
+
+	pieces = ownStraights;
+
+	while (pieces != 0x0000000000000000ULL)
+	{
+		index = GetLSB(pieces);
+		allowedTargets = targetMask;
+
+		if ((checkInfo.Pinned & (0x0000000000000001ULL << index)) != 0x0000000000000000ULL)
 		{
-			moveList.push_back(m);
+			allowedTargets = allowedTargets & Attacks::GetLine(checkInfo.KingIndex, index);
 		}
 
-		Unmake(position, nullMove);
-		Unmake(position, m);
+		count += PopCount(Attacks::GetRookAttacks(index, occupancy) & allowedTargets);
+		pieces = pieces & (pieces - 1);
 	}
-	else
+
+	count += CountPawnMoves(position, ownPawns & ~checkInfo.Pinned, targetMask);
+
+	pieces = ownPawns & checkInfo.Pinned;
+
+	while (pieces != 0x0000000000000000ULL)
+	{
+		index = GetLSB(pieces);
+		count += CountPawnMoves(position, 0x0000000000000001ULL << index,
+			targetMask & Attacks::GetLine(checkInfo.KingIndex, index));
+		pieces = pieces & (pieces - 1);
+	}
+
+	// en passant can expose the king along the rank or remove a checking pawn, so it is
+	// checked against the resulting occupancy like in generation
+
+	if (position.EnPassantTarget != 0x0000000000000000ULL)
 	{
-		moveList.push_back(m);
+		enPassantPawns = ownPawns & GetAttackersTo(position, GetLSB(position.EnPassantTarget), ownPawns,
+			position.ColorToMove);
+
+		while (enPassantPawns != 0x0000000000000000ULL)
+		{
+			if (IsEnPassantLegal(0x0000000000000001ULL << GetLSB(enPassantPawns), position.EnPassantTarget, position))
+			{
+				count++;
+			}
+
+			enPassantPawns = enPassantPawns & (enPassantPawns - 1);
+		}
 	}
+
+	return count;
 }
@@ -0,0 +1,403 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 Nathan McCrina
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "TuxedoCat.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+using namespace TuxedoCat;
+
+static const int PieceValues[7] = { 100, 300, 300, 500, 900, 10000, 0 };
+
+static bool IsTactical(Move move)
+{
+	return MoveUtil::GetCapturedPiece(move) != PieceRank::NONE || MoveUtil::GetPromotedRank(move) != PieceRank::NONE;
+}
+
+void MoveOrdering::InitializePicker(MovePicker& picker, Move hashMove, SearchHeuristics* heuristics, int ply,
+	Move previousMove)
+{
+	picker.CapturesOnly = false;
+	picker.Moves.Count = 0;
+	picker.Index = 0;
+	picker.CaptureCount = 0;
+	picker.HashMove = hashMove;
+	picker.Heuristics = heuristics;
+	picker.Killers[0] = MoveUtil::GetNullMove();
+	picker.Killers[1] = MoveUtil::GetNullMove();
+	picker.CounterMove = MoveUtil::GetNullMove();
+	picker.KillerIndex = 0;
+	picker.Stage = PickerStage::HASH_MOVE;
+
+	if (heuristics != nullptr)
+	{
+		if (ply < SearchHeuristics::MAX_PLY)
+		{
+			picker.Killers[0] = heuristics->Killers[ply][0];
+			picker.Killers[1] = heuristics->Killers[ply][1];
+		}
+
+		picker.CounterMove = GetCounterMove(*heuristics, previousMove);
+	}
+}
+
+void MoveOrdering::InitializeCapturePicker(MovePicker& picker)
+{
+	InitializePicker(picker, MoveUtil::GetNullMove(), nullptr, 0, MoveUtil::GetNullMove());
+
+	picker.CapturesOnly = true;
+	picker.Stage = PickerStage::GENERATE_CAPTURES;
+}
+
+// quiets are ordered by history, with the counter move to the previous move ahead of the rest
+static int ScoreQuiet(MovePicker& picker, Move move)
+{
+	if (picker.Heuristics == nullptr)
+	{
+		return 0;
+	}
+
+	if (move == picker.CounterMove)
+	{
+		return SearchHeuristics::HISTORY_MAX + 1;
+	}
+
+	return picker.Heuristics->History[static_cast<int>(MoveUtil::GetMoveColor(move))]
+		[MoveUtil::GetSourceIndex(move)][MoveUtil::GetTargetIndex(move)];
+}
+
+// history moves towards the bonus and saturates at HISTORY_MAX instead of overflowing
+static void UpdateHistory(int& entry, int bonus)
+{
+	entry += bonus - entry * std::abs(bonus) / SearchHeuristics::HISTORY_MAX;
+}
+
+void MoveOrdering::ClearHeuristics(SearchHeuristics& heuristics)
+{
+	for (int i = 0; i < SearchHeuristics::MAX_PLY; i++)
+	{
+		heuristics.Killers[i][0] = MoveUtil::GetNullMove();
+		heuristics.Killers[i][1] = MoveUtil::GetNullMove();
+	}
+
+	for (int color = 0; color < 2; color++)
+	{
+		for (int from = 0; from < 64; from++)
+		{
+			for (int to = 0; to < 64; to++)
+			{
+				heuristics.History[color][from][to] = 0;
+			}
+		}
+
+		for (int rank = 0; rank < 6; rank++)
+		{
+			for (int to = 0; to < 64; to++)
+			{
+				heuristics.CounterMoves[color][rank][to] = MoveUtil::GetNullMove();
+			}
+		}
+	}
+}
+
+void MoveOrdering::AgeHeuristics(SearchHeuristics& heuristics)
+{
+	// killers belong to the tree of the last search; history is kept at half weight
+
+	for (int i = 0; i < SearchHeuristics::MAX_PLY; i++)
+	{
+		heuristics.Killers[i][0] = MoveUtil::GetNullMove();
+		heuristics.Killers[i][1] = MoveUtil::GetNullMove();
+	}
+
+	for (int color = 0; color < 2; color++)
+	{
+		for (int from = 0; from < 64; from++)
+		{
+			for (int to = 0; to < 64; to++)
+			{
+				heuristics.History[color][from][to] /= 2;
+			}
+		}
+	}
+}
+
+Move MoveOrdering::GetCounterMove(SearchHeuristics& heuristics, Move previousMove)
+{
+	if (MoveUtil::IsNullMove(previousMove))
+	{
+		return MoveUtil::GetNullMove();
+	}
+
+	return heuristics.CounterMoves[static_cast<int>(MoveUtil::GetMoveColor(previousMove))]
+		[static_cast<int>(MoveUtil::GetMovingPiece(previousMove))][MoveUtil::GetTargetIndex(previousMove)];
+}
+
+void MoveOrdering::UpdateQuietHeuristics(SearchHeuristics& heuristics, Move bestMove, Move previousMove, int ply,
+	int depth, Move* quietsTried, int quietCount)
+{
+	int bonus = std::min(depth * depth, 400);
+	int color = static_cast<int>(MoveUtil::GetMoveColor(bestMove));
+
+	if (ply < SearchHeuristics::MAX_PLY && heuristics.Killers[ply][0] != bestMove)
+	{
+		heuristics.Killers[ply][1] = heuristics.Killers[ply][0];
+		heuristics.Killers[ply][0] = bestMove;
+	}
+
+	if (!MoveUtil::IsNullMove(previousMove))
+	{
+		heuristics.CounterMoves[static_cast<int>(MoveUtil::GetMoveColor(previousMove))]
+			[static_cast<int>(MoveUtil::GetMovingPiece(previousMove))][MoveUtil::GetTargetIndex(previousMove)] = bestMove;
+	}
+
+	UpdateHistory(heuristics.History[color][MoveUtil::GetSourceIndex(bestMove)][MoveUtil::GetTargetIndex(bestMove)],
+		bonus);
+
+	// the quiets searched before the cutoff move were wasted effort, so they lose ground
+
+	for (int i = 0; i < quietCount; i++)
+	{
+		if (quietsTried[i] != bestMove)
+		{
+			UpdateHistory(heuristics.History[color][MoveUtil::GetSourceIndex(quietsTried[i])]
+				[MoveUtil::GetTargetIndex(quietsTried[i])], -bonus);
+		}
+	}
+}
+
+int MoveOrdering::GetPieceValue(PieceRank rank)
+{
+	return PieceValues[static_cast<int>(rank)];
+}
+
+int MoveOrdering::GetStaticExchange(Board& position, Move move)
+{
+	int gain[32];
+	int exchangeDepth = 0;
+	int target = MoveUtil::GetTargetIndex(move);
+	uint64_t occupancy = position.WhitePieces | position.BlackPieces;
+	uint64_t from = MoveUtil::GetSourceLocation(move);
+	uint64_t attackers;
+	PieceRank attackerRank = MoveUtil::GetMovingPiece(move);
+	PieceColor side = MoveUtil::GetMoveColor(move);
+
+	// swap list from the chess programming wiki: each side recaptures with its least
+	// valuable attacker, then the list is folded back letting either side stop early
+
+	gain[0] = PieceValues[static_cast<int>(MoveUtil::GetCapturedPiece(move))];
+
+	if ((MoveUtil::GetFlags(move) & MoveFlags::EN_PASSANT) != 0)
+	{
+		occupancy = occupancy ^ (side == PieceColor::WHITE
+			? MoveUtil::GetTargetLocation(move) >> 8 : MoveUtil::GetTargetLocation(move) << 8);
+	}
+
+	do
+	{
+		exchangeDepth++;
+		gain[exchangeDepth] = PieceValues[static_cast<int>(attackerRank)] - gain[exchangeDepth - 1];
+
+		if (std::max(-gain[exchangeDepth - 1], gain[exchangeDepth]) < 0)
+		{
+			break;
+		}
+
+		occupancy = occupancy ^ from;
+		side = side == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
+
+		// recomputing with the reduced occupancy picks up sliders x-raying through
+
+		attackers = MoveGenerator::GetAttackersTo(position, target, occupancy, side);
+		from = 0x0000000000000000ULL;
+
+		for (int rank = 0; rank < 6 && attackers != 0x0000000000000000ULL; rank++)
+		{
+			uint64_t candidates = attackers & Position::GetPieces(position, side, static_cast<PieceRank>(rank));
+
+			if (candidates != 0x0000000000000000ULL)
+			{
+				from = candidates & (~candidates + 1);
+				attackerRank = static_cast<PieceRank>(rank);
+				break;
+			}
+		}
+	} while (from != 0x0000000000000000ULL && exchangeDepth < 31);
+
+	while (--exchangeDepth)
+	{
+		gain[exchangeDepth - 1] = -std::max(-gain[exchangeDepth - 1], gain[exchangeDepth]);
+	}
+
+	return gain[0];
+}
+
+int MoveOrdering::ScoreCapture(Move move)
+{
+	int score = 0;
+
+	// most valuable victim first, least valuable attacker breaks ties; promotions
+	// are scored as if they captured the promoted piece
+
+	if (MoveUtil::GetCapturedPiece(move) != PieceRank::NONE)
+	{
+		score += 8 * (static_cast<int>(MoveUtil::GetCapturedPiece(move)) + 1)
+			- static_cast<int>(MoveUtil::GetMovingPiece(move));
+	}
+
+	if (MoveUtil::GetPromotedRank(move) != PieceRank::NONE)
+	{
+		score += 8 * static_cast<int>(MoveUtil::GetPromotedRank(move));
+	}
+
+	return score;
+}
+
+bool MoveOrdering::GetNextMove(MovePicker& picker, Board& position, Move& move)
+{
+	while (picker.Stage != PickerStage::DONE)
+	{
+		if (picker.Stage == PickerStage::HASH_MOVE)
+		{
+			picker.Stage = PickerStage::GENERATE_CAPTURES;
+
+			if (MoveGenerator::IsLegalMove(position, picker.HashMove))
+			{
+				move = picker.HashMove;
+				return true;
+			}
+
+			picker.HashMove = MoveUtil::GetNullMove();
+		}
+		else if (picker.Stage == PickerStage::GENERATE_CAPTURES)
+		{
+			MoveGenerator::GenerateCaptures(position, picker.Moves);
+
+			for (int i = 0; i < picker.Moves.Count; i++)
+			{
+				picker.Scores[i] = ScoreCapture(picker.Moves.Moves[i]);
+			}
+
+			picker.CaptureCount = picker.Moves.Count;
+			picker.Index = 0;
+			picker.Stage = PickerStage::CAPTURES;
+		}
+		else if (picker.Stage == PickerStage::CAPTURES)
+		{
+			if (picker.Index >= picker.CaptureCount)
+			{
+				picker.Stage = picker.CapturesOnly ? PickerStage::DONE : PickerStage::KILLERS;
+				continue;
+			}
+
+			// selection sort one step at a time, so a cutoff leaves the rest unsorted
+
+			int best = picker.Index;
+
+			for (int i = picker.Index + 1; i < picker.CaptureCount; i++)
+			{
+				if (picker.Scores[i] > picker.Scores[best])
+				{
+					best = i;
+				}
+			}
+
+			std::swap(picker.Moves.Moves[picker.Index], picker.Moves.Moves[best]);
+			std::swap(picker.Scores[picker.Index], picker.Scores[best]);
+
+			move = picker.Moves.Moves[picker.Index++];
+
+			if (move != picker.HashMove)
+			{
+				return true;
+			}
+		}
+		else if (picker.Stage == PickerStage::KILLERS)
+		{
+			if (picker.KillerIndex >= 2)
+			{
+				picker.Stage = PickerStage::GENERATE_QUIETS;
+				continue;
+			}
+
+			move = picker.Killers[picker.KillerIndex++];
+
+			if (!MoveUtil::IsNullMove(move) && !IsTactical(move) && move != picker.HashMove
+				&& (picker.KillerIndex == 1 || move != picker.Killers[0])
+				&& MoveGenerator::IsLegalMove(position, move))
+			{
+				return true;
+			}
+
+			// an unusable killer is dropped so the quiet stage doesn't skip it
+
+			picker.Killers[picker.KillerIndex - 1] = MoveUtil::GetNullMove();
+		}
+		else if (picker.Stage == PickerStage::GENERATE_QUIETS)
+		{
+			// every capture has been handed out by now, so the list can be reused
+
+			MoveGenerator::GenerateQuiets(position, picker.Moves);
+
+			for (int i = 0; i < picker.Moves.Count; i++)
+			{
+				picker.Scores[i] = ScoreQuiet(picker, picker.Moves.Moves[i]);
+			}
+
+			picker.Index = 0;
+			picker.Stage = PickerStage::QUIETS;
+		}
+		else if (picker.Stage == PickerStage::QUIETS)
+		{
+			if (picker.Index >= picker.Moves.Count)
+			{
+				picker.Stage = PickerStage::DONE;
+				continue;
+			}
+
+			int best = picker.Index;
+
+			for (int i = picker.Index + 1; i < picker.Moves.Count; i++)
+			{
+				if (picker.Scores[i] > picker.Scores[best])
+				{
+					best = i;
+				}
+			}
+
+			std::swap(picker.Moves.Moves[picker.Index], picker.Moves.Moves[best]);
+			std::swap(picker.Scores[picker.Index], picker.Scores[best]);
+
+			move = picker.Moves.Moves[picker.Index++];
+
+			if (move != picker.HashMove && move != picker.Killers[0] && move != picker.Killers[1])
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
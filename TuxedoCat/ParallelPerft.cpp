@@ -0,0 +1,159 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 Nathan McCrina
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "TuxedoCat.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+
+using namespace TuxedoCat;
+
+// a subtree left to count: the position after the first few plies and the depth remaining
+struct PerftTask
+{
+	Board Position;
+	int Depth;
+};
+
+// each worker takes tasks from the back of its own queue and, once that's empty,
+// steals from the front of the others
+struct PerftQueue
+{
+	std::mutex Lock;
+	std::deque<PerftTask> Tasks;
+};
+
+static void SplitTasks(Board& position, int depth, int splitDepth, std::vector<PerftTask>& tasks)
+{
+	MoveList availableMoves;
+	UndoInfo undo;
+
+	if (splitDepth == 0)
+	{
+		tasks.push_back(PerftTask{ position, depth });
+		return;
+	}
+
+	MoveGenerator::GenerateMoves(position, availableMoves);
+
+	for (Move* it = availableMoves.Moves; it != availableMoves.Moves + availableMoves.Count; it++)
+	{
+		Position::Make(position, *it, undo);
+		SplitTasks(position, depth - 1, splitDepth - 1, tasks);
+		Position::Unmake(position, *it, undo);
+	}
+}
+
+static bool GetTask(std::vector<std::unique_ptr<PerftQueue>>& queues, int id, PerftTask& task)
+{
+	int queueCount = static_cast<int>(queues.size());
+
+	{
+		std::lock_guard<std::mutex> guard(queues[id]->Lock);
+
+		if (!queues[id]->Tasks.empty())
+		{
+			task = queues[id]->Tasks.back();
+			queues[id]->Tasks.pop_back();
+
+			return true;
+		}
+	}
+
+	for (int i = 1; i < queueCount; i++)
+	{
+		PerftQueue& victim = *queues[(id + i) % queueCount];
+		std::lock_guard<std::mutex> guard(victim.Lock);
+
+		if (!victim.Tasks.empty())
+		{
+			task = victim.Tasks.front();
+			victim.Tasks.pop_front();
+
+			return true;
+		}
+	}
+
+	// nothing is ever queued once the workers are running, so empty queues mean done
+
+	return false;
+}
+
+static void RunWorker(std::vector<std::unique_ptr<PerftQueue>>* queues, int id, uint64_t* nodes)
+{
+	PerftTask task;
+
+	while (GetTask(*queues, id, task))
+	{
+		*nodes += Engine::Perft(task.Position, task.Depth);
+	}
+}
+
+void ParallelPerft::Run(Board& position, int depth, int splitDepth, int threadCount, PerftResult& result)
+{
+	std::vector<PerftTask> tasks;
+	std::vector<std::unique_ptr<PerftQueue>> queues;
+	std::vector<std::thread> workers;
+	std::chrono::high_resolution_clock::time_point start;
+
+	start = std::chrono::high_resolution_clock::now();
+
+	// Engine::Perft counts moves at depth 1, so every task needs at least one ply left
+
+	splitDepth = std::max(0, std::min(splitDepth, depth - 1));
+	threadCount = std::max(1, threadCount);
+
+	SplitTasks(position, depth, splitDepth, tasks);
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		queues.emplace_back(new PerftQueue());
+	}
+
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		queues[i % threadCount]->Tasks.push_back(tasks[i]);
+	}
+
+	result.ThreadNodes.assign(threadCount, 0);
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(RunWorker, &queues, i, &result.ThreadNodes[i]);
+	}
+
+	result.Nodes = 0;
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		workers[i].join();
+		result.Nodes += result.ThreadNodes[i];
+	}
+
+	result.Milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::high_resolution_clock::now() - start).count();
+}
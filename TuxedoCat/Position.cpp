@@ -24,6 +24,7 @@
 
 #include "TuxedoCat.h"
 #include <vector>
+#include <cassert>
 
 using namespace TuxedoCat;
 
@@ -148,6 +149,7 @@ void TuxedoCat::Position::SetPosition(Board& position, std::string fen)
 	position.BlackQueens = 0x0000000000000000ULL;
 	position.BlackKing = 0x0000000000000000ULL;
 	position.BlackPieces = 0x0000000000000000ULL;
+	position.HashKey = 0x0000000000000000ULL;
 
 	for (int i = 0; i < 8; i++)
 	{
@@ -213,319 +215,191 @@ void TuxedoCat::Position::SetPosition(Board& position, std::string fen)
 	position.HalfMoveCounter = std::stoi(fen_parts[4]);
 
 	position.FullMoveCounter = std::stoi(fen_parts[5]);
+
+	position.HashKey = Zobrist::ComputeKey(position);
 }
 
-void TuxedoCat::Position::Make(Board& position, Move mv)
+namespace
 {
-	if (mv.SourceLocation == 0x0000000000000000ULL)
+	// castling rights that survive a move to or from each square (a1 = 0)
+	const int CastlingRightsMask[64] =
+	{
+		13, 15, 15, 15, 12, 15, 15, 14,
+		15, 15, 15, 15, 15, 15, 15, 15,
+		15, 15, 15, 15, 15, 15, 15, 15,
+		15, 15, 15, 15, 15, 15, 15, 15,
+		15, 15, 15, 15, 15, 15, 15, 15,
+		15, 15, 15, 15, 15, 15, 15, 15,
+		15, 15, 15, 15, 15, 15, 15, 15,
+		 7, 15, 15, 15,  3, 15, 15, 11
+	};
+
+	// rook source and target for a castle, given the king's target square
+	void GetCastleRookSquares(uint64_t kingTarget, uint64_t& rookSource, uint64_t& rookTarget)
 	{
-		if (position.ColorToMove == PieceColor::WHITE)
+		if (kingTarget == 0x0000000000000040ULL)
+		{
+			rookSource = 0x0000000000000080ULL;
+			rookTarget = 0x0000000000000020ULL;
+		}
+		else if (kingTarget == 0x0000000000000004ULL)
 		{
-			position.ColorToMove = PieceColor::BLACK;
+			rookSource = 0x0000000000000001ULL;
+			rookTarget = 0x0000000000000008ULL;
+		}
+		else if (kingTarget == 0x4000000000000000ULL)
+		{
+			rookSource = 0x8000000000000000ULL;
+			rookTarget = 0x2000000000000000ULL;
 		}
 		else
 		{
-			position.ColorToMove = PieceColor::WHITE;
-			position.FullMoveCounter++;
+			rookSource = 0x0100000000000000ULL;
+			rookTarget = 0x0800000000000000ULL;
 		}
 	}
-	else
-	{
-		position.EnPassantTarget = 0x00000000000000ULL;
-		//position.HalfMoveCounter = mv.CurrentHalfMoves + 1;
+}
 
-		if (((mv.SourceLocation & position.WhiteKing) != 0x00000000000000ULL
-			|| (mv.SourceLocation & position.BlackKing) != 0x00000000000000ULL)
-			&& ((mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000004ULL)
-				|| (mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000040ULL)
-				|| (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x0400000000000000ULL)
-				|| (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x4000000000000000ULL)))
-		{
-			// castle
+void TuxedoCat::Position::Make(Board& position, Move mv, UndoInfo& undo)
+{
+	undo.EnPassantTarget = position.EnPassantTarget;
+	undo.CastlingStatus = position.CastlingStatus;
+	undo.HalfMoveCounter = position.HalfMoveCounter;
+	undo.HashKey = position.HashKey;
 
-			position.HalfMoveCounter = 0;
+	position.HashKey ^= Zobrist::GetEnPassantKey(position.EnPassantTarget);
+	position.EnPassantTarget = 0x0000000000000000ULL;
 
-			if (mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000004ULL)
-			{
-				// white queen-side
-				AddPieceAt(position, 0x0000000000000004ULL, PieceColor::WHITE, PieceRank::KING);
-				AddPieceAt(position, 0x0000000000000008ULL, PieceColor::WHITE, PieceRank::ROOK);
-				RemovePieceAt(position, 0x0000000000000010ULL);
-				RemovePieceAt(position, 0x0000000000000001ULL);
-
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_SHORT);
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_LONG);
-			}
-			else if (mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000040ULL)
-			{
-				// white king-side
-				AddPieceAt(position, 0x0000000000000040ULL, PieceColor::WHITE, PieceRank::KING);
-				AddPieceAt(position, 0x0000000000000020ULL, PieceColor::WHITE, PieceRank::ROOK);
-				RemovePieceAt(position, 0x0000000000000010ULL);
-				RemovePieceAt(position, 0x0000000000000080ULL);
-
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_SHORT);
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_LONG);
-			}
-			else if (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x0400000000000000ULL)
+	if (!MoveUtil::IsNullMove(mv))
+	{
+		int srcIndex = MoveUtil::GetSourceIndex(mv);
+		int tgtIndex = MoveUtil::GetTargetIndex(mv);
+		uint64_t src = 0x0000000000000001ULL << srcIndex;
+		uint64_t tgt = 0x0000000000000001ULL << tgtIndex;
+		PieceColor color = MoveUtil::GetMoveColor(mv);
+		PieceRank movingPiece = MoveUtil::GetMovingPiece(mv);
+		PieceRank capturedPiece = MoveUtil::GetCapturedPiece(mv);
+		PieceRank promotedRank = MoveUtil::GetPromotedRank(mv);
+		int flags = MoveUtil::GetFlags(mv);
+
+		position.HalfMoveCounter++;
+
+		if (capturedPiece != PieceRank::NONE)
+		{
+			if ((flags & MoveFlags::EN_PASSANT) != 0)
 			{
-				// black queen-side
-				AddPieceAt(position, 0x0400000000000000ULL, PieceColor::BLACK, PieceRank::KING);
-				AddPieceAt(position, 0x0800000000000000ULL, PieceColor::BLACK, PieceRank::ROOK);
-				RemovePieceAt(position, 0x1000000000000000ULL);
-				RemovePieceAt(position, 0x0100000000000000ULL);
-
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_SHORT);
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_LONG);
+				RemovePieceAt(position, color == PieceColor::WHITE ? tgt >> 8 : tgt << 8);
 			}
-			else if (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x4000000000000000ULL)
+			else
 			{
-				// black king-side
-				AddPieceAt(position, 0x4000000000000000ULL, PieceColor::BLACK, PieceRank::KING);
-				AddPieceAt(position, 0x2000000000000000ULL, PieceColor::BLACK, PieceRank::ROOK);
-				RemovePieceAt(position, 0x1000000000000000ULL);
-				RemovePieceAt(position, 0x8000000000000000ULL);
-
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_SHORT);
-				position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_LONG);
+				RemovePieceAt(position, tgt);
 			}
+
+			position.HalfMoveCounter = 0;
 		}
-		else
+
+		if (movingPiece == PieceRank::PAWN)
 		{
-			// not a castle
+			position.HalfMoveCounter = 0;
 
-			if (mv.MovingPiece == PieceRank::PAWN)
-			{
-				// pawn move
-
-				position.HalfMoveCounter = 0;
-
-				if (mv.CapturedPiece != PieceRank::NONE)
-				{
-					if (mv.TargetLocation == mv.CurrentEnPassant)
-					{
-						if (mv.MoveColor == PieceColor::WHITE)
-						{
-							RemovePieceAt(position, mv.TargetLocation >> 8);
-						}
-						else
-						{
-							RemovePieceAt(position, mv.TargetLocation << 8);
-						}
-					}
-					else
-					{
-						if (mv.CapturedPiece == PieceRank::ROOK)
-						{
-							if (mv.TargetLocation == 0x0000000000000001ULL)
-							{
-								position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_LONG);
-							}
-							else if (mv.TargetLocation == 0x0000000000000080ULL)
-							{
-								position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_SHORT);
-							}
-							else if (mv.TargetLocation == 0x0100000000000000ULL)
-							{
-								position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_LONG);
-							}
-							else if (mv.TargetLocation == 0x8000000000000000ULL)
-							{
-								position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_SHORT);
-							}
-						}
-
-						RemovePieceAt(position, mv.TargetLocation);
-					}
-				}
-				else
-				{
-					if (mv.TargetLocation == (mv.SourceLocation << 16))
-					{
-						position.EnPassantTarget = mv.SourceLocation << 8;
-					}
-					else if (mv.TargetLocation == (mv.SourceLocation >> 16))
-					{
-						position.EnPassantTarget = mv.SourceLocation >> 8;
-					}
-				}
-
-				if (mv.PromotedRank != PieceRank::NONE)
-				{
-					AddPieceAt(position, mv.TargetLocation, mv.MoveColor, mv.PromotedRank);
-				}
-				else
-				{
-					AddPieceAt(position, mv.TargetLocation, mv.MoveColor, PieceRank::PAWN);
-				}
-
-				RemovePieceAt(position, mv.SourceLocation);
-			}
-			else
+			if ((flags & MoveFlags::DOUBLE_PUSH) != 0)
 			{
-				if (mv.MovingPiece == PieceRank::ROOK && mv.MoveColor == PieceColor::WHITE
-					&& mv.SourceLocation == 0x0000000000000001ULL)
-				{
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_LONG);
-				}
-				else if (mv.MovingPiece == PieceRank::ROOK && mv.MoveColor == PieceColor::WHITE
-					&& mv.SourceLocation == 0x0000000000000080ULL)
-				{
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_SHORT);
-				}
-				else if (mv.MovingPiece == PieceRank::ROOK && mv.MoveColor == PieceColor::BLACK
-					&& mv.SourceLocation == 0x0100000000000000ULL)
-				{
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_LONG);
-				}
-				else if (mv.MovingPiece == PieceRank::ROOK && mv.MoveColor == PieceColor::BLACK
-					&& mv.SourceLocation == 0x8000000000000000ULL)
-				{
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_SHORT);
-				}
-
-				if (mv.MovingPiece == PieceRank::KING && mv.MoveColor == PieceColor::WHITE)
-				{
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_LONG);
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_SHORT);
-				}
-				else if (mv.MovingPiece == PieceRank::KING && mv.MoveColor == PieceColor::BLACK)
-				{
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_LONG);
-					position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_SHORT);
-				}
-
-				if (mv.CapturedPiece != PieceRank::NONE)
-				{
-					if (mv.CapturedPiece == PieceRank::ROOK)
-					{
-						if (mv.TargetLocation == 0x0000000000000001ULL)
-						{
-							position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_LONG);
-						}
-						else if (mv.TargetLocation == 0x0000000000000080ULL)
-						{
-							position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::WHITE_SHORT);
-						}
-						else if (mv.TargetLocation == 0x0100000000000000ULL)
-						{
-							position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_LONG);
-						}
-						else if (mv.TargetLocation == 0x8000000000000000ULL)
-						{
-							position.CastlingStatus = position.CastlingStatus & (~CastlingFlags::BLACK_SHORT);
-						}
-					}
-					// a capture!
-					RemovePieceAt(position, mv.TargetLocation); // he gone
-					position.HalfMoveCounter = 0;
-				}
-
-				AddPieceAt(position, mv.TargetLocation, mv.MoveColor, mv.MovingPiece);
-				RemovePieceAt(position, mv.SourceLocation);
+				position.EnPassantTarget = color == PieceColor::WHITE ? src << 8 : src >> 8;
+				position.HashKey ^= Zobrist::GetEnPassantKey(position.EnPassantTarget);
 			}
 		}
 
-		if (position.ColorToMove == PieceColor::WHITE)
+		if ((flags & MoveFlags::CASTLE) != 0)
 		{
-			position.ColorToMove = PieceColor::BLACK;
-		}
-		else
-		{
-			position.ColorToMove = PieceColor::WHITE;
-			position.FullMoveCounter++;
+			uint64_t rookSource;
+			uint64_t rookTarget;
+
+			GetCastleRookSquares(tgt, rookSource, rookTarget);
+			RemovePieceAt(position, rookSource);
+			AddPieceAt(position, rookTarget, color, PieceRank::ROOK);
 		}
+
+		RemovePieceAt(position, src);
+		AddPieceAt(position, tgt, color, promotedRank != PieceRank::NONE ? promotedRank : movingPiece);
+
+		position.HashKey ^= Zobrist::GetCastlingKey(position.CastlingStatus);
+		position.CastlingStatus &= CastlingRightsMask[srcIndex] & CastlingRightsMask[tgtIndex];
+		position.HashKey ^= Zobrist::GetCastlingKey(position.CastlingStatus);
+	}
+
+	position.HashKey ^= Zobrist::GetSideKey();
+
+	if (position.ColorToMove == PieceColor::WHITE)
+	{
+		position.ColorToMove = PieceColor::BLACK;
 	}
+	else
+	{
+		position.ColorToMove = PieceColor::WHITE;
+		position.FullMoveCounter++;
+	}
+
+#ifdef _DEBUG
+	assert(position.HashKey == Zobrist::ComputeKey(position));
+#endif
 }
 
-void TuxedoCat::Position::Unmake(Board& position, Move mv)
+void TuxedoCat::Position::Unmake(Board& position, Move mv, UndoInfo& undo)
 {
-	if (mv.SourceLocation == 0x0000000000000000ULL)
+	if (position.ColorToMove == PieceColor::WHITE)
 	{
-		if (position.ColorToMove == PieceColor::WHITE)
-		{
-			position.ColorToMove = PieceColor::BLACK;
-			position.FullMoveCounter--;
-		}
-		else
-		{
-			position.ColorToMove = PieceColor::WHITE;
-		}
+		position.ColorToMove = PieceColor::BLACK;
+		position.FullMoveCounter--;
 	}
 	else
 	{
-		AddPieceAt(position, mv.SourceLocation, mv.MoveColor, mv.MovingPiece);
-		RemovePieceAt(position, mv.TargetLocation);
+		position.ColorToMove = PieceColor::WHITE;
+	}
+
+	if (!MoveUtil::IsNullMove(mv))
+	{
+		uint64_t src = MoveUtil::GetSourceLocation(mv);
+		uint64_t tgt = MoveUtil::GetTargetLocation(mv);
+		PieceColor color = MoveUtil::GetMoveColor(mv);
+		PieceRank capturedPiece = MoveUtil::GetCapturedPiece(mv);
+		int flags = MoveUtil::GetFlags(mv);
 
-		if (((mv.SourceLocation & position.WhiteKing) != 0x0000000000000000ULL
-			|| (mv.SourceLocation & position.BlackKing) != 0x0000000000000000ULL)
-			&& ((mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000004ULL)
-				|| (mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000040ULL)
-				|| (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x0400000000000000ULL)
-				|| (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x4000000000000000ULL)))
-		{
-			uint64_t oldRookLocation = 0x0000000000000000ULL;
-			uint64_t newRookLocation = 0x0000000000000000ULL;
+		RemovePieceAt(position, tgt);
+		AddPieceAt(position, src, color, MoveUtil::GetMovingPiece(mv));
 
-			if (mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000040ULL)
-			{
-				oldRookLocation = 0x0000000000000020ULL;
-				newRookLocation = 0x0000000000000080ULL;
-			}
-			else if (mv.SourceLocation == 0x0000000000000010ULL && mv.TargetLocation == 0x0000000000000004ULL)
-			{
-				oldRookLocation = 0x0000000000000008ULL;
-				newRookLocation = 0x0000000000000001ULL;
-			}
-			else if (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x4000000000000000ULL)
-			{
-				oldRookLocation = 0x2000000000000000ULL;
-				newRookLocation = 0x8000000000000000ULL;
-			}
-			else if (mv.SourceLocation == 0x1000000000000000ULL && mv.TargetLocation == 0x0400000000000000ULL)
-			{
-				oldRookLocation = 0x0800000000000000ULL;
-				newRookLocation = 0x0100000000000000ULL;
-			}
+		if ((flags & MoveFlags::CASTLE) != 0)
+		{
+			uint64_t rookSource;
+			uint64_t rookTarget;
 
-			RemovePieceAt(position, mv.TargetLocation);
-			RemovePieceAt(position, oldRookLocation);
-			AddPieceAt(position, mv.SourceLocation, mv.MoveColor, PieceRank::KING);
-			AddPieceAt(position, newRookLocation, mv.MoveColor, PieceRank::ROOK);
+			GetCastleRookSquares(tgt, rookSource, rookTarget);
+			RemovePieceAt(position, rookTarget);
+			AddPieceAt(position, rookSource, color, PieceRank::ROOK);
 		}
 
-		if (mv.CapturedPiece != PieceRank::NONE)
+		if (capturedPiece != PieceRank::NONE)
 		{
-			if (mv.CurrentEnPassant != 0x0000000000000000ULL && mv.MovingPiece == PieceRank::PAWN
-				&& mv.TargetLocation == mv.CurrentEnPassant)
+			PieceColor capturedColor = color == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
+
+			if ((flags & MoveFlags::EN_PASSANT) != 0)
 			{
-				if (mv.MoveColor == PieceColor::WHITE)
-				{
-					AddPieceAt(position, mv.TargetLocation >> 8, PieceColor::BLACK, mv.CapturedPiece);
-				}
-				else
-				{
-					AddPieceAt(position, mv.TargetLocation << 8, PieceColor::WHITE, mv.CapturedPiece);
-				}
+				AddPieceAt(position, color == PieceColor::WHITE ? tgt >> 8 : tgt << 8, capturedColor, capturedPiece);
 			}
 			else
 			{
-				AddPieceAt(position, mv.TargetLocation,
-					mv.MoveColor == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE,
-					mv.CapturedPiece);
+				AddPieceAt(position, tgt, capturedColor, capturedPiece);
 			}
 		}
+	}
 
-		position.ColorToMove = mv.MoveColor;
-		position.CastlingStatus = mv.CastlingStatus;
-		position.EnPassantTarget = mv.CurrentEnPassant;
-		position.HalfMoveCounter = mv.CurrentHalfMoves;
+	position.EnPassantTarget = undo.EnPassantTarget;
+	position.CastlingStatus = undo.CastlingStatus;
+	position.HalfMoveCounter = undo.HalfMoveCounter;
+	position.HashKey = undo.HashKey;
 
-		if (mv.MoveColor == PieceColor::BLACK)
-		{
-			position.FullMoveCounter--;
-		}
-	}
+#ifdef _DEBUG
+	assert(position.HashKey == Zobrist::ComputeKey(position));
+#endif
 }
 
 void TuxedoCat::Position::AddPieceAt(Board& position, uint64_t loc, PieceColor color, PieceRank rank)
@@ -597,24 +471,46 @@ void TuxedoCat::Position::AddPieceAt(Board& position, uint64_t loc, PieceColor c
 		}
 	}
 
+	// loc is expected to be empty, so every square in it is a piece entering the key
+
+	for (uint64_t squares = loc; squares != 0x0000000000000000ULL; squares = squares & (squares - 1))
+	{
+		position.HashKey ^= Zobrist::GetPieceKey(color, rank, Utility::GetLSB(squares));
+	}
+
 	UpdatePieces(position);
 }
 
+// clears location from one piece bitboard, taking whatever was there out of the key
+static void RemoveFromBitboard(uint64_t& pieces, uint64_t location, PieceColor color, PieceRank rank,
+	uint64_t& hashKey)
+{
+	uint64_t removed = pieces & location;
+
+	while (removed != 0x0000000000000000ULL)
+	{
+		hashKey ^= Zobrist::GetPieceKey(color, rank, Utility::GetLSB(removed));
+		removed = removed & (removed - 1);
+	}
+
+	pieces = pieces & (~location);
+}
+
 void TuxedoCat::Position::RemovePieceAt(Board& position, uint64_t location)
 {
-	position.WhitePawns = position.WhitePawns & (~location);
-	position.WhiteKnights = position.WhiteKnights & (~location);
-	position.WhiteBishops = position.WhiteBishops & (~location);
-	position.WhiteRooks = position.WhiteRooks & (~location);
-	position.WhiteQueens = position.WhiteQueens & (~location);
-	position.WhiteKing = position.WhiteKing & (~location);
-
-	position.BlackPawns = position.BlackPawns & (~location);
-	position.BlackKnights = position.BlackKnights & (~location);
-	position.BlackBishops = position.BlackBishops & (~location);
-	position.BlackRooks = position.BlackRooks & (~location);
-	position.BlackQueens = position.BlackQueens & (~location);
-	position.BlackKing = position.BlackKing & (~location);
+	RemoveFromBitboard(position.WhitePawns, location, PieceColor::WHITE, PieceRank::PAWN, position.HashKey);
+	RemoveFromBitboard(position.WhiteKnights, location, PieceColor::WHITE, PieceRank::KNIGHT, position.HashKey);
+	RemoveFromBitboard(position.WhiteBishops, location, PieceColor::WHITE, PieceRank::BISHOP, position.HashKey);
+	RemoveFromBitboard(position.WhiteRooks, location, PieceColor::WHITE, PieceRank::ROOK, position.HashKey);
+	RemoveFromBitboard(position.WhiteQueens, location, PieceColor::WHITE, PieceRank::QUEEN, position.HashKey);
+	RemoveFromBitboard(position.WhiteKing, location, PieceColor::WHITE, PieceRank::KING, position.HashKey);
+
+	RemoveFromBitboard(position.BlackPawns, location, PieceColor::BLACK, PieceRank::PAWN, position.HashKey);
+	RemoveFromBitboard(position.BlackKnights, location, PieceColor::BLACK, PieceRank::KNIGHT, position.HashKey);
+	RemoveFromBitboard(position.BlackBishops, location, PieceColor::BLACK, PieceRank::BISHOP, position.HashKey);
+	RemoveFromBitboard(position.BlackRooks, location, PieceColor::BLACK, PieceRank::ROOK, position.HashKey);
+	RemoveFromBitboard(position.BlackQueens, location, PieceColor::BLACK, PieceRank::QUEEN, position.HashKey);
+	RemoveFromBitboard(position.BlackKing, location, PieceColor::BLACK, PieceRank::KING, position.HashKey);
 
 	UpdatePieces(position);
 }
@@ -679,6 +575,38 @@ PieceColor TuxedoCat::Position::GetColorAt(Board& position, uint64_t loc)
 	return color;
 }
 
+uint64_t TuxedoCat::Position::GetPieces(Board& position, PieceColor color, PieceRank rank)
+{
+	uint64_t pieces = 0x0000000000000000ULL;
+
+	if (rank == PieceRank::PAWN)
+	{
+		pieces = color == PieceColor::WHITE ? position.WhitePawns : position.BlackPawns;
+	}
+	else if (rank == PieceRank::KNIGHT)
+	{
+		pieces = color == PieceColor::WHITE ? position.WhiteKnights : position.BlackKnights;
+	}
+	else if (rank == PieceRank::BISHOP)
+	{
+		pieces = color == PieceColor::WHITE ? position.WhiteBishops : position.BlackBishops;
+	}
+	else if (rank == PieceRank::ROOK)
+	{
+		pieces = color == PieceColor::WHITE ? position.WhiteRooks : position.BlackRooks;
+	}
+	else if (rank == PieceRank::QUEEN)
+	{
+		pieces = color == PieceColor::WHITE ? position.WhiteQueens : position.BlackQueens;
+	}
+	else if (rank == PieceRank::KING)
+	{
+		pieces = color == PieceColor::WHITE ? position.WhiteKing : position.BlackKing;
+	}
+
+	return pieces;
+}
+
 void TuxedoCat::Position::UpdatePieces(Board& position)
 {
 	position.WhitePieces = (position.WhitePawns
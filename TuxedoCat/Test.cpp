@@ -24,13 +24,53 @@
 
 #include "TuxedoCat.h"
 #include <iostream>
+#include <set>
 
 using namespace TuxedoCat;
 
+// walks the tree and counts positions where the incremental key disagrees with a fresh one
+static int CountKeyMismatches(Board& position, int depth)
+{
+	MoveList moveList;
+	UndoInfo undo;
+	int mismatches = position.HashKey == Zobrist::ComputeKey(position) ? 0 : 1;
+	uint64_t key = position.HashKey;
+
+	if (depth == 0)
+	{
+		return mismatches;
+	}
+
+	MoveGenerator::GenerateMoves(position, moveList);
+
+	for (int i = 0; i < moveList.Count; i++)
+	{
+		Position::Make(position, moveList.Moves[i], undo);
+		mismatches += CountKeyMismatches(position, depth - 1);
+		Position::Unmake(position, moveList.Moves[i], undo);
+
+		if (position.HashKey != key)
+		{
+			mismatches++;
+		}
+	}
+
+	return mismatches;
+}
+
 void Test::RunTests()
 {
 	TestPerft();
 	GetDoubledPawnCountTest();
+	MovePickerTest();
+	GenerateCapturesTest();
+	ZobristTest();
+	TranspositionTableTest();
+	StaticExchangeTest();
+	ParallelPerftTest();
+	HashedPerftTest();
+	CountLegalMovesTest();
+	GivesCheckTest();
 
 	std::cout << "Tests complete!" << std::endl;
 }
@@ -117,4 +157,288 @@ void Test::GetDoubledPawnCountTest()
 	position.BlackPawns = 0x0093484800000000ULL;
 
 	PrintTestResult("GetDoubledPawnCount, scenario 4", 2, Position::GetDoubledPawnCount(position, PieceColor::BLACK));
-}
\ No newline at end of file
+}
+void Test::MovePickerTest()
+{
+	Board position;
+	MovePicker picker;
+	Move move;
+	Move hashMove;
+	Move killer;
+	SearchHeuristics heuristics;
+	MoveList moveList;
+	std::set<uint32_t> generated;
+	std::set<uint32_t> picked;
+	int count = 0;
+
+	Position::SetPosition(position, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	MoveGenerator::GenerateMoves(position, moveList);
+
+	for (int i = 0; i < moveList.Count; i++)
+	{
+		generated.insert(moveList.Moves[i].Data);
+	}
+
+	hashMove = Utility::GetMoveFromXBoardNotation(position, "e1g1");
+	killer = Utility::GetMoveFromXBoardNotation(position, "a2a3");
+
+	MoveOrdering::ClearHeuristics(heuristics);
+	heuristics.Killers[0][0] = killer;
+
+	MoveOrdering::InitializePicker(picker, hashMove, &heuristics, 0, MoveUtil::GetNullMove());
+
+	MoveOrdering::GetNextMove(picker, position, move);
+	picked.insert(move.Data);
+	count++;
+
+	PrintTestResult("MovePicker: hash move first", Utility::GenerateXBoardNotation(hashMove),
+		Utility::GenerateXBoardNotation(move));
+
+	while (MoveOrdering::GetNextMove(picker, position, move))
+	{
+		picked.insert(move.Data);
+		count++;
+	}
+
+	// the picker has to hand out exactly the generated moves, each of them once
+
+	PrintTestResult("MovePicker: no duplicates", static_cast<int>(picked.size()), count);
+	PrintTestResult("MovePicker: same moves as GenerateMoves", true, picked == generated);
+
+	// a hash move that isn't legal here (black's castle) has to be skipped
+
+	MoveUtil::InitializeMove(hashMove, 60, 62, PieceColor::BLACK, PieceRank::KING, PieceRank::NONE,
+		PieceRank::NONE, MoveFlags::CASTLE);
+	MoveOrdering::InitializePicker(picker, hashMove, nullptr, 0, MoveUtil::GetNullMove());
+	picked.clear();
+	count = 0;
+
+	while (MoveOrdering::GetNextMove(picker, position, move))
+	{
+		picked.insert(move.Data);
+		count++;
+	}
+
+	PrintTestResult("MovePicker: illegal hash move skipped", 48, count);
+	PrintTestResult("MovePicker: illegal hash move, same moves as GenerateMoves", true, picked == generated);
+}
+
+void Test::GenerateCapturesTest()
+{
+	Board position;
+	MoveList captures;
+	MoveList quiets;
+
+	Position::SetPosition(position, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+	MoveGenerator::GenerateCaptures(position, captures);
+	MoveGenerator::GenerateQuiets(position, quiets);
+
+	PrintTestResult("GenerateCaptures: position 2", 8, captures.Count);
+	PrintTestResult("GenerateQuiets: position 2", 40, quiets.Count);
+
+	// promotions (with and without capture) belong to the captures
+
+	Position::SetPosition(position, "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 b kq - 0 1");
+
+	MoveGenerator::GenerateCaptures(position, captures);
+	MoveGenerator::GenerateQuiets(position, quiets);
+
+	PrintTestResult("GenerateCaptures: position 4", 19, captures.Count);
+	PrintTestResult("GenerateQuiets: position 4", 27, quiets.Count);
+}
+
+void Test::ZobristTest()
+{
+	Board position;
+	Board transposed;
+	UndoInfo undo;
+
+	Position::SetPosition(position, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+	PrintTestResult("Zobrist: incremental key, position 2", 0, CountKeyMismatches(position, 3));
+
+	Position::SetPosition(position, "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+
+	PrintTestResult("Zobrist: incremental key, position 4", 0, CountKeyMismatches(position, 3));
+
+	// the same position reached by a different move order has the same key
+
+	Position::SetPosition(position, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	Position::SetPosition(transposed, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+	Position::Make(position, Utility::GetMoveFromXBoardNotation(position, "g1f3"), undo);
+	Position::Make(position, Utility::GetMoveFromXBoardNotation(position, "g8f6"), undo);
+	Position::Make(position, Utility::GetMoveFromXBoardNotation(position, "b1c3"), undo);
+	Position::Make(transposed, Utility::GetMoveFromXBoardNotation(transposed, "b1c3"), undo);
+	Position::Make(transposed, Utility::GetMoveFromXBoardNotation(transposed, "g8f6"), undo);
+	Position::Make(transposed, Utility::GetMoveFromXBoardNotation(transposed, "g1f3"), undo);
+
+	PrintTestResult("Zobrist: transposition", position.HashKey, transposed.HashKey);
+}
+
+void Test::TranspositionTableTest()
+{
+	Board position;
+	HashEntry entry;
+	Move move;
+
+	Position::SetPosition(position, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	move = Utility::GetMoveFromXBoardNotation(position, "e2a6");
+
+	TranspositionTable::Clear();
+
+	PrintTestResult("TranspositionTable: empty probe misses", false, TranspositionTable::Probe(position.HashKey, entry));
+
+	TranspositionTable::Store(position.HashKey, 7, BoundType::LOWER, -2999990, move);
+
+	PrintTestResult("TranspositionTable: probe hits", true, TranspositionTable::Probe(position.HashKey, entry));
+	PrintTestResult("TranspositionTable: depth", 7, entry.Depth);
+	PrintTestResult("TranspositionTable: score", -2999990, entry.Score);
+	PrintTestResult("TranspositionTable: bound", true, entry.Bound == BoundType::LOWER);
+	PrintTestResult("TranspositionTable: best move", Utility::GenerateXBoardNotation(move),
+		Utility::GenerateXBoardNotation(entry.BestMove));
+
+	// storing again without a move keeps the one already there
+
+	TranspositionTable::Store(position.HashKey, 8, BoundType::EXACT, 15, MoveUtil::GetNullMove());
+	TranspositionTable::Probe(position.HashKey, entry);
+
+	PrintTestResult("TranspositionTable: best move kept", Utility::GenerateXBoardNotation(move),
+		Utility::GenerateXBoardNotation(entry.BestMove));
+
+	TranspositionTable::Clear();
+}
+
+void Test::StaticExchangeTest()
+{
+	Board position;
+
+	Position::SetPosition(position, "4k3/8/8/3p4/8/8/8/3RK3 w - - 0 1");
+
+	PrintTestResult("GetStaticExchange: undefended pawn", 100,
+		MoveOrdering::GetStaticExchange(position, Utility::GetMoveFromXBoardNotation(position, "d1d5")));
+
+	Position::SetPosition(position, "4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1");
+
+	PrintTestResult("GetStaticExchange: defended pawn", -800,
+		MoveOrdering::GetStaticExchange(position, Utility::GetMoveFromXBoardNotation(position, "d1d5")));
+
+	// the second rook behind the first joins in once the first one has captured
+
+	Position::SetPosition(position, "4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1");
+
+	PrintTestResult("GetStaticExchange: x-ray recapture", 100,
+		MoveOrdering::GetStaticExchange(position, Utility::GetMoveFromXBoardNotation(position, "d2d5")));
+}
+
+void Test::ParallelPerftTest()
+{
+	Board board;
+	PerftResult result;
+
+	Position::SetPosition(board, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+	ParallelPerft::Run(board, 4, 2, 3, result);
+
+	PrintTestResult("ParallelPerft: position 2, depth 4, 3 threads", static_cast<uint64_t>(4085603), result.Nodes);
+
+	// a split depth at or past the full depth still has to count the last ply
+
+	ParallelPerft::Run(board, 2, 5, 2, result);
+
+	PrintTestResult("ParallelPerft: split depth clamped", static_cast<uint64_t>(2039), result.Nodes);
+}
+
+void Test::HashedPerftTest()
+{
+	Board board;
+
+	Position::SetPosition(board, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+	PrintTestResult("HashedPerft: position 2, depth 4", static_cast<uint64_t>(4085603),
+		Engine::HashedPerft(board, 4, Engine::DEFAULT_PERFT_HASH_MB));
+
+	Position::SetPosition(board, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+
+	// a tiny table forces constant replacement, which mustn't change the count
+
+	PrintTestResult("HashedPerft: position 3, depth 5, tiny table", static_cast<uint64_t>(674624),
+		Engine::HashedPerft(board, 5, 0));
+}
+
+void Test::CountLegalMovesTest()
+{
+	Board board;
+	MoveList moveList;
+	std::vector<std::string> positions = {
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/8/8/KPp4r/8/8/8/7k w - c6 0 2",
+		"8/8/8/8/k2Pp2Q/8/8/3K4 b - d3 0 1",
+		"4k3/8/8/8/8/8/1p4r1/R3K2R w KQ - 0 1",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		"4k3/1P6/8/8/8/8/8/4K2q w - - 0 1",
+		"3qk3/8/8/8/8/8/3R4/2BKQ3 w - - 0 1"
+	};
+
+	// the counting path has to agree with generation, en passant pins and evasions included
+
+	for (auto it = positions.begin(); it != positions.end(); it++)
+	{
+		Position::SetPosition(board, *it);
+		MoveGenerator::GenerateMoves(board, moveList);
+
+		PrintTestResult("CountLegalMoves: " + *it, moveList.Count, MoveGenerator::CountLegalMoves(board));
+	}
+}
+
+void Test::GivesCheckTest()
+{
+	Board board;
+	MoveList moveList;
+	UndoInfo undo;
+	std::vector<std::string> positions = {
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"3k4/8/3q4/8/3B4/8/3K4/8 w - - 0 1",
+		"8/8/2k5/8/3P4/8/1N2K3/8 w - - 0 1",
+		"8/3p4/8/2K2n2/8/8/8/6k1 b - - 0 1"
+	};
+
+	// castling and en passant are always reported as checks, so only the rest are compared
+
+	for (auto it = positions.begin(); it != positions.end(); it++)
+	{
+		int mismatches = 0;
+
+		Position::SetPosition(board, *it);
+		MoveGenerator::GenerateMoves(board, moveList);
+
+		for (int i = 0; i < moveList.Count; i++)
+		{
+			Move move = moveList.Moves[i];
+			uint64_t king;
+			bool expected;
+
+			if ((MoveUtil::GetFlags(move) & (MoveFlags::CASTLE | MoveFlags::EN_PASSANT)) != 0)
+			{
+				continue;
+			}
+
+			Position::Make(board, move, undo);
+			king = board.ColorToMove == PieceColor::WHITE ? board.WhiteKing : board.BlackKing;
+			expected = MoveGenerator::IsSquareAttacked(king, board);
+			Position::Unmake(board, move, undo);
+
+			if (MoveGenerator::GivesCheck(board, move) != expected)
+			{
+				mismatches++;
+			}
+		}
+
+		PrintTestResult("GivesCheck: " + *it, 0, mismatches);
+	}
+}
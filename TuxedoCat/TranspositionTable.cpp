@@ -0,0 +1,196 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 Nathan McCrina
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "TuxedoCat.h"
+#include <atomic>
+#include <memory>
+#include <new>
+#include <sstream>
+
+using namespace TuxedoCat;
+
+/*
+ * each entry is two 64-bit words: the packed data and the key xor'd with that data. a reader
+ * that sees a torn write from another thread gets a key mismatch and treats it as a miss, so
+ * no locking is needed.
+ *
+ * data layout: move (bits 0-24), depth (25-32), bound (33-34), age (35-40), score + 2^22 (41-63)
+ */
+
+struct HashSlot
+{
+	std::atomic<uint64_t> Check;
+	std::atomic<uint64_t> Data;
+};
+
+// four slots fill one 64-byte cache line
+struct HashBucket
+{
+	HashSlot Slots[4];
+};
+
+static std::unique_ptr<char[]> tableStorage;
+static HashBucket* table = nullptr;
+static uint64_t bucketCount = 0;
+static int currentAge = 0;
+
+static const int SCORE_OFFSET = 0x400000;
+
+static uint64_t PackData(Move move, int depth, BoundType bound, int age, int score)
+{
+	return static_cast<uint64_t>(move.Data & 0x1FFFFFF)
+		| (static_cast<uint64_t>(depth & 0xFF) << 25)
+		| (static_cast<uint64_t>(bound) << 33)
+		| (static_cast<uint64_t>(age & 0x3F) << 35)
+		| (static_cast<uint64_t>(score + SCORE_OFFSET) << 41);
+}
+
+static int GetDataDepth(uint64_t data)
+{
+	return static_cast<int>((data >> 25) & 0xFF);
+}
+
+static int GetDataAge(uint64_t data)
+{
+	return static_cast<int>((data >> 35) & 0x3F);
+}
+
+void TranspositionTable::Resize(uint64_t megabytes)
+{
+	uint64_t count = 1;
+	std::stringstream logText;
+
+	// largest power of two number of buckets that fits, so the index is a mask
+
+	while (count * 2 * sizeof(HashBucket) <= megabytes * 1024 * 1024)
+	{
+		count = count * 2;
+	}
+
+	tableStorage.reset();
+	tableStorage.reset(new char[count * sizeof(HashBucket) + 64]);
+
+	table = reinterpret_cast<HashBucket*>((reinterpret_cast<uintptr_t>(tableStorage.get()) + 63)
+		& ~static_cast<uintptr_t>(63));
+	bucketCount = count;
+
+	for (uint64_t i = 0; i < bucketCount; i++)
+	{
+		new (&table[i]) HashBucket();
+	}
+
+	Clear();
+
+	logText << "transposition table: " << (bucketCount * sizeof(HashBucket)) / (1024 * 1024) << " MB, "
+		<< bucketCount * 4 << " entries";
+	Logger::Write(LogLevel::Info, logText.str());
+}
+
+void TranspositionTable::Clear()
+{
+	for (uint64_t i = 0; i < bucketCount; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			table[i].Slots[j].Check.store(0, std::memory_order_relaxed);
+			table[i].Slots[j].Data.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	currentAge = 0;
+}
+
+void TranspositionTable::NewSearch()
+{
+	currentAge = (currentAge + 1) & 0x3F;
+}
+
+bool TranspositionTable::Probe(uint64_t key, HashEntry& entry)
+{
+	HashBucket& bucket = table[key & (bucketCount - 1)];
+
+	for (int i = 0; i < 4; i++)
+	{
+		uint64_t data = bucket.Slots[i].Data.load(std::memory_order_relaxed);
+		uint64_t check = bucket.Slots[i].Check.load(std::memory_order_relaxed);
+
+		if ((check ^ data) == key && data != 0)
+		{
+			entry.BestMove.Data = static_cast<uint32_t>(data & 0x1FFFFFF);
+			entry.Depth = GetDataDepth(data);
+			entry.Bound = static_cast<BoundType>((data >> 33) & 0x3);
+			entry.Score = static_cast<int>(data >> 41) - SCORE_OFFSET;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TranspositionTable::Store(uint64_t key, int depth, BoundType bound, int score, Move bestMove)
+{
+	HashBucket& bucket = table[key & (bucketCount - 1)];
+	int replaceIndex = 0;
+	int replaceValue = 0x7FFFFFFF;
+
+	for (int i = 0; i < 4; i++)
+	{
+		uint64_t data = bucket.Slots[i].Data.load(std::memory_order_relaxed);
+		uint64_t check = bucket.Slots[i].Check.load(std::memory_order_relaxed);
+
+		if ((check ^ data) == key)
+		{
+			// same position: keep the old best move if this search didn't produce one
+
+			if (MoveUtil::IsNullMove(bestMove))
+			{
+				bestMove.Data = static_cast<uint32_t>(data & 0x1FFFFFF);
+			}
+
+			replaceIndex = i;
+			break;
+		}
+
+		// otherwise evict the shallowest entry, counting entries from older searches as shallower
+
+		int value = GetDataDepth(data) - 8 * ((currentAge - GetDataAge(data)) & 0x3F);
+
+		if (data == 0)
+		{
+			value = -0x7FFFFFFF;
+		}
+
+		if (value < replaceValue)
+		{
+			replaceValue = value;
+			replaceIndex = i;
+		}
+	}
+
+	uint64_t newData = PackData(bestMove, depth, bound, currentAge, score);
+
+	bucket.Slots[replaceIndex].Data.store(newData, std::memory_order_relaxed);
+	bucket.Slots[replaceIndex].Check.store(key ^ newData, std::memory_order_relaxed);
+}
@@ -28,12 +28,18 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <sstream>
+#include <atomic>
 
 namespace TuxedoCat
 {
 	enum class PieceRank { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, NONE };
 	enum class PieceColor { WHITE, BLACK, NONE };
 	enum class TimeControlType { CONVENTIONAL, INCREMENTAL, TIME_PER_MOVE };
+	enum class GenerationType { ALL, CAPTURES, QUIETS };
+	enum class BoundType { NONE, EXACT, LOWER, UPPER };
+	enum class PickerStage { HASH_MOVE, GENERATE_CAPTURES, CAPTURES, KILLERS, GENERATE_QUIETS, QUIETS, DONE };
+	enum class LogLevel { Debug, Info, Error };
 
 
 	struct CastlingFlags
@@ -53,17 +59,28 @@ namespace TuxedoCat
 		uint32_t timeIncrement;
 	};
 
+	struct MoveFlags
+	{
+		static const int NONE = 0;
+		static const int CASTLE = 1;
+		static const int EN_PASSANT = 2;
+		static const int DOUBLE_PUSH = 4;
+	};
+
+	// packed move: source (bits 0-5), target (6-11), moving piece (12-14),
+	// captured piece (15-17), promoted rank (18-20), flags (21-23), color (24)
 	struct Move
 	{
-		uint64_t TargetLocation;
-		uint64_t SourceLocation;
-		uint64_t CurrentEnPassant;
-		PieceColor MoveColor;
-		PieceRank MovingPiece;
-		PieceRank CapturedPiece;
-		PieceRank PromotedRank;
-		int CurrentHalfMoves;
+		uint32_t Data;
+	};
+
+	// state that can't be recovered from the move itself, saved by Make for Unmake
+	struct UndoInfo
+	{
+		uint64_t EnPassantTarget;
+		uint64_t HashKey;
 		int CastlingStatus;
+		int HalfMoveCounter;
 	};
 
 	struct Board
@@ -91,28 +108,135 @@ namespace TuxedoCat
 		int FullMoveCounter;
 
 		PieceColor ColorToMove;
+
+		uint64_t HashKey;
+	};
+
+	struct MoveList
+	{
+		static const int CAPACITY = 256;
+
+		Move Moves[CAPACITY];
+		int Count;
+	};
+
+	// quiet move ordering learned from beta cutoffs during the search
+	struct SearchHeuristics
+	{
+		static const int MAX_PLY = 128;
+		static const int HISTORY_MAX = 16384;
+
+		Move Killers[MAX_PLY][2];
+		int History[2][64][64];
+		Move CounterMoves[2][6][64];
+	};
+
+	// hands out moves one at a time: hash move, captures by MVV-LVA, killers, then quiets by history
+	struct MovePicker
+	{
+		MoveList Moves;
+		int Scores[MoveList::CAPACITY];
+		int Index;
+		int CaptureCount;
+		Move HashMove;
+		Move Killers[2];
+		Move CounterMove;
+		SearchHeuristics* Heuristics;
+		int KillerIndex;
+		bool CapturesOnly;
+		PickerStage Stage;
+	};
+
+	struct HashEntry
+	{
+		Move BestMove;
+		int Score;
+		int Depth;
+		BoundType Bound;
+	};
+
+	struct PerftResult
+	{
+		uint64_t Nodes;
+		std::vector<uint64_t> ThreadNodes;
+		long long Milliseconds;
+	};
+
+	// triangular pv table: row ply holds the pv from that ply on, at most MAX_PLY - ply moves
+	struct PVTable
+	{
+		static const int MAX_PLY = 128;
+
+		Move Moves[MAX_PLY][MAX_PLY];
+		int Length[MAX_PLY];
+	};
+
+	// what one search thread owns; threads share nothing but the transposition table
+	struct SearchThread
+	{
+		int Id;
+		Board Position;
+		SearchHeuristics Heuristics;
+		PVTable PV;
+		uint64_t NodeCount;
+		uint64_t QuiescenceNodeCount;
+		bool Stopped;
+		int PollCountdown;
+	};
+
+	struct CheckInfo
+	{
+		uint64_t Checkers;
+		uint64_t Pinned;
+		uint64_t KingLocation;
+		int KingIndex;
 	};
 
 	PieceColor GetPieceColorFromChar(char piece);
 	PieceRank GetPieceRankFromChar(char piece);
 
 	inline bool operator==(const Move& lhs, const Move& rhs) {
-		return (lhs.CapturedPiece == rhs.CapturedPiece
-			&& lhs.CastlingStatus == rhs.CastlingStatus
-			&& lhs.CurrentEnPassant == rhs.CurrentEnPassant
-			&& lhs.CurrentHalfMoves == rhs.CurrentHalfMoves
-			&& lhs.MoveColor == rhs.MoveColor
-			&& lhs.MovingPiece == rhs.MovingPiece
-			&& lhs.PromotedRank == rhs.PromotedRank
-			&& lhs.SourceLocation == rhs.SourceLocation
-			&& lhs.TargetLocation == rhs.TargetLocation);
+		return lhs.Data == rhs.Data;
+	}
+
+	inline bool operator!=(const Move& lhs, const Move& rhs) {
+		return lhs.Data != rhs.Data;
 	}
 
 	namespace MoveUtil
 	{
 		bool compareMoves(Move& m1, Move& m2);
-		void InitializeMove(Move& move, uint64_t tgt, uint64_t src, uint64_t cep, PieceColor mc, PieceRank mp,
-			PieceRank cp, PieceRank pr, int chm, int cs);
+
+		inline void InitializeMove(Move& move, int src, int tgt, PieceColor mc, PieceRank mp,
+			PieceRank cp, PieceRank pr, int flags)
+		{
+			move.Data = (uint32_t)src
+				| ((uint32_t)tgt << 6)
+				| ((uint32_t)mp << 12)
+				| ((uint32_t)cp << 15)
+				| ((uint32_t)pr << 18)
+				| ((uint32_t)flags << 21)
+				| ((uint32_t)mc << 24);
+		}
+
+		// the null move has source == target (all zero bits)
+		inline Move GetNullMove()
+		{
+			Move move;
+			move.Data = 0;
+			return move;
+		}
+
+		inline int GetSourceIndex(Move move) { return move.Data & 0x3F; }
+		inline int GetTargetIndex(Move move) { return (move.Data >> 6) & 0x3F; }
+		inline uint64_t GetSourceLocation(Move move) { return 0x0000000000000001ULL << GetSourceIndex(move); }
+		inline uint64_t GetTargetLocation(Move move) { return 0x0000000000000001ULL << GetTargetIndex(move); }
+		inline PieceRank GetMovingPiece(Move move) { return (PieceRank)((move.Data >> 12) & 0x7); }
+		inline PieceRank GetCapturedPiece(Move move) { return (PieceRank)((move.Data >> 15) & 0x7); }
+		inline PieceRank GetPromotedRank(Move move) { return (PieceRank)((move.Data >> 18) & 0x7); }
+		inline int GetFlags(Move move) { return (move.Data >> 21) & 0x7; }
+		inline PieceColor GetMoveColor(Move move) { return (PieceColor)((move.Data >> 24) & 0x1); }
+		inline bool IsNullMove(Move move) { return GetSourceIndex(move) == GetTargetIndex(move); }
 	}
 
 	namespace Position
@@ -122,8 +246,9 @@ namespace TuxedoCat
 		void RemovePieceAt(Board& position, uint64_t location);
 		PieceRank GetRankAt(Board& position, uint64_t loc);
 		PieceColor GetColorAt(Board& position, uint64_t loc);
-		void Make(Board& position, Move mv);
-		void Unmake(Board& position, Move mv);
+		uint64_t GetPieces(Board& position, PieceColor color, PieceRank rank);
+		void Make(Board& position, Move mv, UndoInfo& undo);
+		void Unmake(Board& position, Move mv, UndoInfo& undo);
 		void UpdatePieces(Board& position);
 		uint64_t GetPassedPawns(Board& position, PieceColor color);
 		int GetDoubledPawnCount(Board& position, PieceColor color);
@@ -131,20 +256,93 @@ namespace TuxedoCat
 
 	namespace MoveGenerator
 	{
-		bool IsPiecePinned(Board& position, uint64_t location, int offset);
-		bool IsPiecePinnedNWSE(Board& position, uint64_t location);
-		bool IsPiecePinnedSWNE(Board& position, uint64_t location);
-		bool IsPiecePinnedRank(Board& position, uint64_t location);
-		bool IsPiecePinnedFile(Board& position, uint64_t location);
+		void GetCheckInfo(Board& position, CheckInfo& info);
+		uint64_t GetAttackersTo(Board& position, int square, uint64_t occupancy, PieceColor color);
 		void GenerateSlidingMovesAt(Board& position, uint64_t location,
-			uint16_t direction, bool evade);
-		void AddMove(uint64_t src, uint64_t tgt, PieceRank rank, PieceColor color, int hm, int cs, uint64_t ep,
-			PieceRank capture, PieceRank promotion, bool evade, Board& position);
-		void GeneratePawnMovesAt(uint64_t location, Board& position, bool evade);
-		void GenerateKnightMovesAt(uint64_t location, Board& position, bool evade);
-		void GenerateKingMovesAt(uint64_t location, Board& position, bool evade);
+			PieceRank rank, uint64_t allowedTargets, MoveList& moveList);
+		void AddMove(uint64_t src, uint64_t tgt, PieceRank rank, PieceColor color, PieceRank capture,
+			PieceRank promotion, int flags, MoveList& moveList);
+		void GeneratePawnMovesAt(uint64_t location, Board& position, uint64_t allowedTargets, GenerationType type,
+			MoveList& moveList);
+		void GenerateKnightMovesAt(uint64_t location, Board& position, uint64_t allowedTargets, MoveList& moveList);
+		void GenerateKingMovesAt(uint64_t location, Board& position, uint64_t allowedTargets, bool includeCastling,
+			MoveList& moveList);
+		void GeneratePieceMoves(Board& position, uint64_t pieces, uint64_t targetMask, GenerationType type,
+			CheckInfo& checkInfo, MoveList& moveList);
+		void GenerateEvasions(Board& position, uint64_t pieces, GenerationType type, CheckInfo& checkInfo,
+			MoveList& moveList);
 		bool IsSquareAttacked(uint64_t square, Board& position);
-		std::vector<Move> GenerateMoves(Board& position, PieceRank rankFilter = PieceRank::NONE);
+		bool IsLegalMove(Board& position, Move move);
+		bool GivesCheck(Board& position, Move move);
+		void GenerateMoves(Board& position, MoveList& moveList, PieceRank rankFilter = PieceRank::NONE);
+		void GenerateCaptures(Board& position, MoveList& moveList);
+		void GenerateQuiets(Board& position, MoveList& moveList);
+		int CountLegalMoves(Board& position);
+	}
+
+	namespace MoveOrdering
+	{
+		void InitializePicker(MovePicker& picker, Move hashMove, SearchHeuristics* heuristics, int ply,
+			Move previousMove);
+		void InitializeCapturePicker(MovePicker& picker);
+		int GetPieceValue(PieceRank rank);
+		int GetStaticExchange(Board& position, Move move);
+		bool GetNextMove(MovePicker& picker, Board& position, Move& move);
+		int ScoreCapture(Move move);
+		void ClearHeuristics(SearchHeuristics& heuristics);
+		void AgeHeuristics(SearchHeuristics& heuristics);
+		Move GetCounterMove(SearchHeuristics& heuristics, Move previousMove);
+		void UpdateQuietHeuristics(SearchHeuristics& heuristics, Move bestMove, Move previousMove, int ply,
+			int depth, Move* quietsTried, int quietCount);
+	}
+
+	namespace Zobrist
+	{
+		void InitializeKeys();
+		uint64_t GetPieceKey(PieceColor color, PieceRank rank, int square);
+		uint64_t GetCastlingKey(int castlingStatus);
+		uint64_t GetEnPassantKey(uint64_t enPassantTarget);
+		uint64_t GetSideKey();
+		uint64_t ComputeKey(Board& position);
+	}
+
+	namespace ParallelPerft
+	{
+		static const int DEFAULT_SPLIT_DEPTH = 2;
+
+		void Run(Board& position, int depth, int splitDepth, int threadCount, PerftResult& result);
+	}
+
+	namespace TranspositionTable
+	{
+		static const uint64_t DEFAULT_SIZE_MB = 64;
+
+		void Resize(uint64_t megabytes);
+		void Clear();
+		void NewSearch();
+		bool Probe(uint64_t key, HashEntry& entry);
+		void Store(uint64_t key, int depth, BoundType bound, int score, Move bestMove);
+	}
+
+	namespace Attacks
+	{
+		void InitializeAttacks();
+		uint64_t GetBishopAttacks(int square, uint64_t occupancy);
+		uint64_t GetRookAttacks(int square, uint64_t occupancy);
+		uint64_t GetQueenAttacks(int square, uint64_t occupancy);
+		uint64_t GetLine(int from, int to);
+		uint64_t GetBetween(int from, int to);
+		std::string GetBackendName();
+	}
+
+	namespace Logger
+	{
+		static const int QUEUE_SIZE = 4096;
+		static const int FLUSH_INTERVAL_MS = 50;
+
+		void Start(std::string fileName);
+		void Stop();
+		void Write(LogLevel level, std::string message);
 	}
 
 	namespace Utility
@@ -159,29 +357,42 @@ namespace TuxedoCat
 		int GetRankFromLocation(uint64_t location);
 		TuxedoCat::Move GetMoveFromXBoardNotation(Board& position, std::string moveString);
 		std::string GenerateXBoardNotation(Move move);
-		std::string GenerateSAN(Board& position, Move move, std::vector<Move> allMoves);
+		std::string GenerateSAN(Board& position, Move move, MoveList& allMoves);
 		std::string PrintMove(Move move);
 		std::string RankToString(PieceRank rank);
 		std::string ColorToString(PieceColor color);
 		std::string CastlingStatusToString(int flags);
-		void WriteLog(std::string msg);
 		bool ComparePieces(PieceRank pr1, PieceRank pr2);
 	}
 
 	namespace Engine
 	{
+		static const uint64_t DEFAULT_PERFT_HASH_MB = 64;
+
 		uint64_t Perft(Board& position, int depth);
+		uint64_t HashedPerft(Board& position, int depth, uint64_t megabytes);
 		void Divide(Board& position, int depth);
-		std::string GetMove(Board& position, TimeControl& clock);
 		std::string GetRandomMove(Board& position);
 		bool IsGameOver(Board& position);
 		std::string GetGameResult(Board& position);
 		void InitializeEngine();
 		int EvaluatePosition(Board& position);
-		int Search(Board& position, int depth);
+		void SetThreadCount(int count);
+		int Search(SearchThread& thread, int depth, int alpha, int beta, int ply, Move previousMove);
+		int Quiescence(SearchThread& thread, int alpha, int beta, int ply);
 		Move SearchRoot(Board& position, TimeControl& clock);
+		void StartSearch(Board& position, TimeControl& clock);
+		void SetSearchFinishedHandler(void (*handler)());
+		void StartPonder(Board& position, TimeControl& clock);
+		void PonderHit(Board& position, TimeControl& clock);
+		bool IsPondering();
+		Move GetPonderMove();
+		void StopSearch();
+		bool IsSearching();
+		bool IsSearchFinished();
+		Move WaitForSearch();
 		uint64_t GetAvailableSearchTime(TimeControl& clock, Board& position);
-		std::string BuildPVString();
+		std::string BuildPVString(SearchThread& thread);
 	}
 
 	namespace Interface
@@ -195,6 +406,15 @@ namespace TuxedoCat
 	{
 		void TestPerft();
 		void GetDoubledPawnCountTest();
+		void MovePickerTest();
+		void GenerateCapturesTest();
+		void ZobristTest();
+		void TranspositionTableTest();
+		void StaticExchangeTest();
+		void ParallelPerftTest();
+		void HashedPerftTest();
+		void CountLegalMovesTest();
+		void GivesCheckTest();
 		void RunTests();
 
 		template <class T>
@@ -221,7 +441,9 @@ extern struct TuxedoCat::Board currentPosition;
 extern struct TuxedoCat::TimeControl currentClock;
 extern int maxSearchDepth;
 extern bool randomMode;
-extern bool showThinkingOutput;
+extern std::atomic<bool> showThinkingOutput;
+extern bool seePruning;
+extern bool lateMoveReductions;
 extern uint64_t KnightAttacks[64];
 extern uint64_t KingAttacks[64];
 extern uint64_t RayAttacksN[64];
@@ -232,3 +454,17 @@ extern uint64_t RayAttacksNW[64];
 extern uint64_t RayAttacksSW[64];
 extern uint64_t RayAttacksNE[64];
 extern uint64_t RayAttacksSE[64];
+
+// debug messages are built from stream expressions inside the macro, so defining
+// TUXEDOCAT_NO_DEBUG_LOG compiles away the formatting along with the call
+#ifdef TUXEDOCAT_NO_DEBUG_LOG
+#define TUXEDOCAT_LOG_DEBUG(expression) do { } while (0)
+#else
+#define TUXEDOCAT_LOG_DEBUG(expression) \
+	do \
+	{ \
+		std::ostringstream debugText; \
+		debugText << expression; \
+		TuxedoCat::Logger::Write(TuxedoCat::LogLevel::Debug, debugText.str()); \
+	} while (0)
+#endif
@@ -30,14 +30,6 @@
 #include <sstream>
 #include <cctype>
 #include <iostream>
-#include <fstream>
-#include <ctime>
-#include <chrono>
-#include <iomanip>
-
-#ifdef _WIN32
-#include <time.h>
-#endif
 
 using namespace TuxedoCat;
 
@@ -207,81 +199,48 @@ uint64_t Utility::GetMaskFromRankOrFile(char rankorfile)
 
 TuxedoCat::Move Utility::GetMoveFromXBoardNotation(Board& position, std::string moveString)
 {
-	Move move;
-	std::vector<Move> legalMoves;
-	bool isLegalMove = false;
-
-	move.SourceLocation = GetSquareFromAlgebraic(moveString.substr(0, 2));
-	move.TargetLocation = GetSquareFromAlgebraic(moveString.substr(2, 2));
-	move.MoveColor = position.ColorToMove;
-	move.CastlingStatus = position.CastlingStatus;
-	move.CurrentEnPassant = position.EnPassantTarget;
-	move.CurrentHalfMoves = position.HalfMoveCounter;
-	move.MovingPiece = Position::GetRankAt(position, move.SourceLocation);
-	
+	Move move = MoveUtil::GetNullMove();
+	MoveList legalMoves;
+	uint64_t sourceLocation = GetSquareFromAlgebraic(moveString.substr(0, 2));
+	uint64_t targetLocation = GetSquareFromAlgebraic(moveString.substr(2, 2));
+	PieceRank promotedRank = PieceRank::NONE;
+
 	if (moveString.length() == 5)
 	{
 		if (moveString[4] == 'q')
 		{
-			move.PromotedRank = PieceRank::QUEEN;
+			promotedRank = PieceRank::QUEEN;
 		}
 		else if (moveString[4] == 'r')
 		{
-			move.PromotedRank = PieceRank::ROOK;
+			promotedRank = PieceRank::ROOK;
 		}
 		else if (moveString[4] == 'b')
 		{
-			move.PromotedRank = PieceRank::BISHOP;
+			promotedRank = PieceRank::BISHOP;
 		}
 		else if (moveString[4] == 'n')
 		{
-			move.PromotedRank = PieceRank::KNIGHT;
+			promotedRank = PieceRank::KNIGHT;
 		}
 	}
-	else
-	{
-		move.PromotedRank = PieceRank::NONE;
-	}
 
-	if (position.ColorToMove == PieceColor::WHITE)
-	{
-		if (move.MovingPiece == PieceRank::PAWN && move.TargetLocation == position.EnPassantTarget)
-		{
-			move.CapturedPiece = Position::GetRankAt(position, ((move.TargetLocation >> 8) & position.BlackPawns));
-		}
-		else
-		{
-			move.CapturedPiece = Position::GetRankAt(position, (move.TargetLocation & position.BlackPieces));
-		}
-	}
-	else if (position.ColorToMove == PieceColor::BLACK)
-	{
-		if (move.MovingPiece == PieceRank::PAWN && move.TargetLocation == position.EnPassantTarget)
-		{
-			move.CapturedPiece = Position::GetRankAt(position, ((move.TargetLocation << 8) & position.WhitePawns));
-		}
-		else
-		{
-			move.CapturedPiece = Position::GetRankAt(position, (move.TargetLocation & position.WhitePieces));
-		}
-	}
+	MoveGenerator::GenerateMoves(position, legalMoves);
 
-	legalMoves = MoveGenerator::GenerateMoves(position);
+	// everything else about the move (piece, capture, flags) follows from the position,
+	// so matching the squares and promotion against the legal moves is enough
 
-	for (auto it = legalMoves.begin(); it != legalMoves.end(); it++)
+	for (int i = 0; i < legalMoves.Count; i++)
 	{
-		if (move == *it)
+		if (MoveUtil::GetSourceLocation(legalMoves.Moves[i]) == sourceLocation
+			&& MoveUtil::GetTargetLocation(legalMoves.Moves[i]) == targetLocation
+			&& MoveUtil::GetPromotedRank(legalMoves.Moves[i]) == promotedRank)
 		{
-			isLegalMove = true;
+			move = legalMoves.Moves[i];
 			break;
 		}
 	}
 
-	if (!isLegalMove)
-	{
-		move.TargetLocation = 0;
-	}
-
 	return move;
 }
 
@@ -290,24 +249,28 @@ std::string Utility::GenerateXBoardNotation(Move move)
 	std::stringstream ss;
 	std::string result = "";
 
-	ss << GetFileFromLocation(move.SourceLocation) << GetRankFromLocation(move.SourceLocation)
-		<< GetFileFromLocation(move.TargetLocation) << GetRankFromLocation(move.TargetLocation);
+	uint64_t sourceLocation = MoveUtil::GetSourceLocation(move);
+	uint64_t targetLocation = MoveUtil::GetTargetLocation(move);
+	PieceRank promotedRank = MoveUtil::GetPromotedRank(move);
 
-	if (move.PromotedRank != PieceRank::NONE)
+	ss << GetFileFromLocation(sourceLocation) << GetRankFromLocation(sourceLocation)
+		<< GetFileFromLocation(targetLocation) << GetRankFromLocation(targetLocation);
+
+	if (promotedRank != PieceRank::NONE)
 	{
-		if (move.PromotedRank == PieceRank::KNIGHT)
+		if (promotedRank == PieceRank::KNIGHT)
 		{
 			ss << 'n';
 		}
-		else if (move.PromotedRank == PieceRank::BISHOP)
+		else if (promotedRank == PieceRank::BISHOP)
 		{
 			ss << 'b';
 		}
-		else if (move.PromotedRank == PieceRank::ROOK)
+		else if (promotedRank == PieceRank::ROOK)
 		{
 			ss << 'r';
 		}
-		else if (move.PromotedRank == PieceRank::QUEEN)
+		else if (promotedRank == PieceRank::QUEEN)
 		{
 			ss << 'q';
 		}
@@ -404,60 +367,78 @@ std::string Utility::CastlingStatusToString(int flags)
 std::string Utility::PrintMove(Move move)
 {
 	std::stringstream moveString;
+	uint64_t sourceLocation = MoveUtil::GetSourceLocation(move);
+	uint64_t targetLocation = MoveUtil::GetTargetLocation(move);
+	int flags = MoveUtil::GetFlags(move);
 
 	moveString << std::endl << "********" << std::endl;
-	moveString << "Source: " << GetFileFromLocation(move.SourceLocation) << GetRankFromLocation(move.SourceLocation) << std::endl;
-	moveString << "Target: " << GetFileFromLocation(move.TargetLocation) << GetRankFromLocation(move.TargetLocation) << std::endl;
-	moveString << "Piece: " << RankToString(move.MovingPiece) << std::endl;
-	moveString << "Color: " << ColorToString(move.MoveColor) << std::endl;
-	moveString << "Captured Piece: " << RankToString(move.CapturedPiece) << std::endl;
-	moveString << "Promoted Rank: " << RankToString(move.PromotedRank) << std::endl;
-	moveString << "Castling Status: " << CastlingStatusToString(move.CastlingStatus) << std::endl;
+	moveString << "Source: " << GetFileFromLocation(sourceLocation) << GetRankFromLocation(sourceLocation) << std::endl;
+	moveString << "Target: " << GetFileFromLocation(targetLocation) << GetRankFromLocation(targetLocation) << std::endl;
+	moveString << "Piece: " << RankToString(MoveUtil::GetMovingPiece(move)) << std::endl;
+	moveString << "Color: " << ColorToString(MoveUtil::GetMoveColor(move)) << std::endl;
+	moveString << "Captured Piece: " << RankToString(MoveUtil::GetCapturedPiece(move)) << std::endl;
+	moveString << "Promoted Rank: " << RankToString(MoveUtil::GetPromotedRank(move)) << std::endl;
+	moveString << "Flags:";
 
-	if (move.CurrentEnPassant != 0)
+	if ((flags & MoveFlags::CASTLE) != 0)
 	{
-		moveString << "En Passant: " << GetFileFromLocation(move.CurrentEnPassant) << GetRankFromLocation(move.CurrentEnPassant) << std::endl;
+		moveString << " castle";
 	}
-	else
+
+	if ((flags & MoveFlags::EN_PASSANT) != 0)
 	{
-		moveString << "En Passant: none" << std::endl;
+		moveString << " en passant";
 	}
 
-	moveString << "Half Move Counter: " << move.CurrentHalfMoves << std::endl;
+	if ((flags & MoveFlags::DOUBLE_PUSH) != 0)
+	{
+		moveString << " double push";
+	}
+
+	if (flags == MoveFlags::NONE)
+	{
+		moveString << " none";
+	}
+
+	moveString << std::endl;
 	moveString << "********" << std::endl;
 
 	return moveString.str();
 }
 
-std::string Utility::GenerateSAN(Board& position, Move move, std::vector<Move> allMoves)
+std::string Utility::GenerateSAN(Board& position, Move move, MoveList& allMoves)
 {
 	std::stringstream san;
 	bool isCastle = false;
+	UndoInfo undo;
+	uint64_t sourceLocation = MoveUtil::GetSourceLocation(move);
+	uint64_t targetLocation = MoveUtil::GetTargetLocation(move);
+	PieceColor moveColor = MoveUtil::GetMoveColor(move);
+	PieceRank movingPiece = MoveUtil::GetMovingPiece(move);
+	PieceRank capturedPiece = MoveUtil::GetCapturedPiece(move);
+	PieceRank promotedRank = MoveUtil::GetPromotedRank(move);
 
-	if (move.MovingPiece != PieceRank::PAWN)
+	if (movingPiece != PieceRank::PAWN)
 	{
-		if (move.MovingPiece == PieceRank::KNIGHT)
+		if (movingPiece == PieceRank::KNIGHT)
 		{
 			san << "N";
 		}
-		else if (move.MovingPiece == PieceRank::BISHOP)
+		else if (movingPiece == PieceRank::BISHOP)
 		{
 			san << "B";
 		}
-		else if (move.MovingPiece == PieceRank::ROOK)
+		else if (movingPiece == PieceRank::ROOK)
 		{
 			san << "R";
 		}
-		else if (move.MovingPiece == PieceRank::QUEEN)
+		else if (movingPiece == PieceRank::QUEEN)
 		{
 			san << "Q";
 		}
-		else if (move.MovingPiece == PieceRank::KING)
+		else if (movingPiece == PieceRank::KING)
 		{
-			if ((move.SourceLocation == 0x0000000000000010UL && move.TargetLocation == 0x0000000000000004UL)
-				|| (move.SourceLocation == 0x0000000000000010UL && move.TargetLocation == 0x0000000000000040UL)
-				|| (move.SourceLocation == 0x1000000000000000UL && move.TargetLocation == 0x0400000000000000UL)
-				|| (move.SourceLocation == 0x1000000000000000UL && move.TargetLocation == 0x4000000000000000UL))
+			if ((MoveUtil::GetFlags(move) & MoveFlags::CASTLE) != 0)
 			{
 				isCastle = true;
 			}
@@ -471,25 +452,25 @@ std::string Utility::GenerateSAN(Board& position, Move move, std::vector<Move> a
 		{
 			uint64_t pieces = 0x0000000000000000UL;
 
-			if (move.MovingPiece == PieceRank::KNIGHT)
+			if (movingPiece == PieceRank::KNIGHT)
 			{
 				pieces =
-					move.MoveColor == PieceColor::WHITE ? position.WhiteKnights : position.BlackKnights;
+					moveColor == PieceColor::WHITE ? position.WhiteKnights : position.BlackKnights;
 			}
-			else if (move.MovingPiece == PieceRank::BISHOP)
+			else if (movingPiece == PieceRank::BISHOP)
 			{
 				pieces =
-					move.MoveColor == PieceColor::WHITE ? position.WhiteBishops : position.BlackBishops;
+					moveColor == PieceColor::WHITE ? position.WhiteBishops : position.BlackBishops;
 			}
-			else if (move.MovingPiece == PieceRank::ROOK)
+			else if (movingPiece == PieceRank::ROOK)
 			{
 				pieces =
-					move.MoveColor == PieceColor::WHITE ? position.WhiteRooks : position.BlackRooks;
+					moveColor == PieceColor::WHITE ? position.WhiteRooks : position.BlackRooks;
 			}
-			else if (move.MovingPiece == PieceRank::QUEEN)
+			else if (movingPiece == PieceRank::QUEEN)
 			{
 				pieces =
-					move.MoveColor == PieceColor::WHITE ? position.WhiteQueens : position.BlackQueens;
+					moveColor == PieceColor::WHITE ? position.WhiteQueens : position.BlackQueens;
 			}
 
 
@@ -497,12 +478,12 @@ std::string Utility::GenerateSAN(Board& position, Move move, std::vector<Move> a
 			{
 				std::vector<Move> possibleMoves;
 				
-				for (auto it = allMoves.cbegin(); it != allMoves.cend(); it++)
+				for (Move* it = allMoves.Moves; it != allMoves.Moves + allMoves.Count; it++)
 				{
-					if (it->MovingPiece == move.MovingPiece
-						&& it->MoveColor == move.MoveColor
-						&& it->TargetLocation == move.TargetLocation
-						&& it->SourceLocation != move.SourceLocation)
+					if (MoveUtil::GetMovingPiece(*it) == movingPiece
+						&& MoveUtil::GetMoveColor(*it) == moveColor
+						&& MoveUtil::GetTargetLocation(*it) == targetLocation
+						&& MoveUtil::GetSourceLocation(*it) != sourceLocation)
 					{
 						possibleMoves.push_back(*it);
 					}
@@ -515,12 +496,12 @@ std::string Utility::GenerateSAN(Board& position, Move move, std::vector<Move> a
 
 					for (auto it = possibleMoves.cbegin(); it != possibleMoves.cend(); it++)
 					{
-						if (GetFileFromLocation(it->SourceLocation) == GetFileFromLocation(move.SourceLocation))
+						if (GetFileFromLocation(MoveUtil::GetSourceLocation(*it)) == GetFileFromLocation(sourceLocation))
 						{
 							conflictFile = true;
 						}
 
-						if (GetRankFromLocation(it->SourceLocation) == GetRankFromLocation(move.SourceLocation))
+						if (GetRankFromLocation(MoveUtil::GetSourceLocation(*it)) == GetRankFromLocation(sourceLocation))
 						{
 							conflictRank = true;
 						}
@@ -528,31 +509,31 @@ std::string Utility::GenerateSAN(Board& position, Move move, std::vector<Move> a
 
 					if (!conflictFile)
 					{
-						san << GetFileFromLocation(move.SourceLocation);
+						san << GetFileFromLocation(sourceLocation);
 					}
 					else if (!conflictRank)
 					{
-						san << GetRankFromLocation(move.SourceLocation);
+						san << GetRankFromLocation(sourceLocation);
 					}
 					else
 					{
-						san << GetFileFromLocation(move.SourceLocation);
-						san << GetRankFromLocation(move.SourceLocation);
+						san << GetFileFromLocation(sourceLocation);
+						san << GetRankFromLocation(sourceLocation);
 					}
 				}
 			}
 
-			if (move.CapturedPiece != PieceRank::NONE)
+			if (capturedPiece != PieceRank::NONE)
 			{
 				san << "x";
 			}
 
-			san << GetFileFromLocation(move.TargetLocation);
-			san << GetRankFromLocation(move.TargetLocation);
+			san << GetFileFromLocation(targetLocation);
+			san << GetRankFromLocation(targetLocation);
 		}
 		else
 		{
-			if (move.TargetLocation == 0x0000000000000040UL || move.TargetLocation == 0x4000000000000000UL)
+			if (targetLocation == 0x0000000000000040UL || targetLocation == 0x4000000000000000UL)
 			{
 				san << "0-0";
 			}
@@ -564,53 +545,52 @@ std::string Utility::GenerateSAN(Board& position, Move move, std::vector<Move> a
 	}
 	else
 	{
-		if (move.CapturedPiece != PieceRank::NONE)
+		if (capturedPiece != PieceRank::NONE)
 		{
-			san << GetFileFromLocation(move.SourceLocation);
+			san << GetFileFromLocation(sourceLocation);
 			san << "x";
 		}
 
-		san << GetFileFromLocation(move.TargetLocation);
-		san << GetRankFromLocation(move.TargetLocation);
+		san << GetFileFromLocation(targetLocation);
+		san << GetRankFromLocation(targetLocation);
 
-		if (move.TargetLocation == position.EnPassantTarget
-			&& move.CapturedPiece != PieceRank::NONE)
+		if ((MoveUtil::GetFlags(move) & MoveFlags::EN_PASSANT) != 0)
 		{
 			san << "e.p";
 		}
 
-		if (move.PromotedRank != PieceRank::NONE)
+		if (promotedRank != PieceRank::NONE)
 		{
 			san << "=";
 
-			if (move.PromotedRank == PieceRank::KNIGHT)
+			if (promotedRank == PieceRank::KNIGHT)
 			{
 				san << "N";
 			}
-			else if (move.PromotedRank == PieceRank::BISHOP)
+			else if (promotedRank == PieceRank::BISHOP)
 			{
 				san << "B";
 			}
-			else if (move.PromotedRank == PieceRank::ROOK)
+			else if (promotedRank == PieceRank::ROOK)
 			{
 				san << "R";
 			}
-			else if (move.PromotedRank == PieceRank::QUEEN)
+			else if (promotedRank == PieceRank::QUEEN)
 			{
 				san << "Q";
 			}
 		}
 	}
 
-	Position::Make(position, move);
+	Position::Make(position, move, undo);
 
-	if ((move.MoveColor == PieceColor::WHITE && MoveGenerator::IsSquareAttacked(position.BlackKing, position))
-		|| (move.MoveColor == PieceColor::BLACK && MoveGenerator::IsSquareAttacked(position.WhiteKing, position)))
+	if ((moveColor == PieceColor::WHITE && MoveGenerator::IsSquareAttacked(position.BlackKing, position))
+		|| (moveColor == PieceColor::BLACK && MoveGenerator::IsSquareAttacked(position.WhiteKing, position)))
 	{
 		san << "+";
 	}
 
-	Position::Unmake(position, move);
+	Position::Unmake(position, move, undo);
 
 	return san.str();
 }
@@ -654,29 +634,6 @@ int Utility::GetRankFromLocation(uint64_t location)
 	return index;
 }
 
-void Utility::WriteLog(std::string msg)
-{
-	std::ofstream fout;
-	std::time_t currentTime;
-    
-    #ifdef _WIN32
-	std::tm tm_struct;
-    #endif
-
-	currentTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-
-	fout.open("log.txt", std::ios_base::app);
-
-    #ifdef _WIN32
-	localtime_s(&tm_struct, &currentTime);
-	fout << std::put_time(&tm_struct, "%c") << ": " << msg << std::endl;
-    #else
-    fout << std::put_time(localtime(&currentTime), "%c") << ": " << msg << std::endl;
-    #endif
-
-	fout.close();
-}
-
 bool Utility::ComparePieces(PieceRank pr1, PieceRank pr2)
 {
 	bool result = false;
@@ -0,0 +1,126 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 Nathan McCrina
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "TuxedoCat.h"
+
+using namespace TuxedoCat;
+
+static uint64_t PieceKeys[2][6][64];
+static uint64_t CastlingKeys[16];
+static uint64_t EnPassantKeys[8];
+static uint64_t SideKey;
+
+// xorshift64*, seeded with a constant so keys are the same from run to run
+static uint64_t GetRandomKey(uint64_t& state)
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+
+	return state * 0x2545F4914F6CDD1DULL;
+}
+
+void Zobrist::InitializeKeys()
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+	for (int color = 0; color < 2; color++)
+	{
+		for (int rank = 0; rank < 6; rank++)
+		{
+			for (int square = 0; square < 64; square++)
+			{
+				PieceKeys[color][rank][square] = GetRandomKey(state);
+			}
+		}
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		CastlingKeys[i] = GetRandomKey(state);
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		EnPassantKeys[i] = GetRandomKey(state);
+	}
+
+	SideKey = GetRandomKey(state);
+}
+
+uint64_t Zobrist::GetPieceKey(PieceColor color, PieceRank rank, int square)
+{
+	return PieceKeys[static_cast<int>(color)][static_cast<int>(rank)][square];
+}
+
+uint64_t Zobrist::GetCastlingKey(int castlingStatus)
+{
+	return CastlingKeys[castlingStatus];
+}
+
+uint64_t Zobrist::GetEnPassantKey(uint64_t enPassantTarget)
+{
+	// only the file matters, the rank follows from the side to move
+
+	if (enPassantTarget == 0x0000000000000000ULL)
+	{
+		return 0x0000000000000000ULL;
+	}
+
+	return EnPassantKeys[Utility::GetLSB(enPassantTarget) & 7];
+}
+
+uint64_t Zobrist::GetSideKey()
+{
+	return SideKey;
+}
+
+uint64_t Zobrist::ComputeKey(Board& position)
+{
+	uint64_t key = 0x0000000000000000ULL;
+	uint64_t pieces;
+	int square;
+
+	pieces = position.WhitePieces | position.BlackPieces;
+
+	while (pieces != 0x0000000000000000ULL)
+	{
+		square = Utility::GetLSB(pieces);
+
+		key ^= GetPieceKey(Position::GetColorAt(position, 0x0000000000000001ULL << square),
+			Position::GetRankAt(position, 0x0000000000000001ULL << square), square);
+
+		pieces = pieces & (pieces - 1);
+	}
+
+	if (position.ColorToMove == PieceColor::BLACK)
+	{
+		key ^= SideKey;
+	}
+
+	key ^= GetCastlingKey(position.CastlingStatus);
+	key ^= GetEnPassantKey(position.EnPassantTarget);
+
+	return key;
+}